@@ -9,19 +9,34 @@
 #include "network.hpp"
 #include <stdio.h>
 #include <thread>
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <vector>
+
+#define EVDEV_DIR   "/dev/input"
+#endif
 
 namespace gamepad
 {
     volatile bool hook_state = false;
     volatile bool hook_run_flag = true;
-	gamepad_handle pad_handles[PAD_COUNT];
+	gamepad_handle pad_handles[CLIENT_PAD_COUNT];
 
 #ifdef _WIN32
     HANDLE hook_thread;
 #else
     pthread_t game_pad_hook_thread;
+    static int epoll_fd = -1;
 #endif
 
+    /* Last time changes were handed to the network thread */
+    static uint64_t last_notify = 0;
+
 	gamepad_handle::~gamepad_handle()
     {
 		unload();
@@ -32,9 +47,7 @@ namespace gamepad
 #ifdef _WIN32
 		RtlZeroMemory(&m_x_input, sizeof(xinput_fix::gamepad));
 #else
-		if (m_device_file)
-			fclose(m_device_file);
-		m_device_file = nullptr;
+		m_device.close();
 #endif
     }
 
@@ -43,14 +56,6 @@ namespace gamepad
 #ifdef _WIN32
 		unload();
 		update();
-#else
-		m_device_file = fopen(m_path.c_str(), "wb+");
-		if (m_device_file)
-		{
-			void * tmp = malloc(8 * 12 * sizeof(char));
-			fread(tmp, sizeof(char) * 8 * 12, 1, m_device_file);
-			free(tmp);
-		}
 #endif
     }
 
@@ -60,7 +65,7 @@ namespace gamepad
 		update();
 		return m_valid;
 #else
-		return m_device_file != nullptr && m_pad_id >= 0;
+		return m_device.valid() && m_pad_id >= 0;
 #endif
     }
 
@@ -72,10 +77,6 @@ namespace gamepad
 #else
 		unload();
 		m_pad_id = pad_id;
-		m_path.clear();
-		m_path = "/dev/input/js";
-		m_path.append(std::to_string(pad_id));
-		load();
 #endif
     }
 
@@ -84,18 +85,33 @@ namespace gamepad
 		return m_pad_id;
     }
 
-    gamepad_state* gamepad_handle::get_state()
+    bool gamepad_handle::update_state(gamepad_state * new_state)
     {
-        return &m_current_state;
+        if (!new_state)
+            return false;
+
+        std::lock_guard<std::mutex> lock(m_state_lock);
+        const auto old_buttons = m_current_state.button_states;
+        if (m_current_state.merge(new_state))
+            m_changed = true;
+        return m_current_state.button_states != old_buttons;
     }
 
-    void gamepad_handle::update_state(gamepad_state * new_state)
+    bool gamepad_handle::take_changes(gamepad_state& state)
     {
-        if (new_state)
-        {
-            if (m_current_state.merge(new_state))
-                m_changed = true;
-        }
+        std::lock_guard<std::mutex> lock(m_state_lock);
+        if (!m_changed)
+            return false;
+
+        state = m_current_state;
+        m_changed = false;
+        return true;
+    }
+
+    bool gamepad_handle::changed()
+    {
+        std::lock_guard<std::mutex> lock(m_state_lock);
+        return m_changed;
     }
 
 #ifdef _WIN32
@@ -113,10 +129,16 @@ namespace gamepad
     }
 
 #else
-	FILE * gamepad_state::dev()
-	{
-		return m_device_file;
-	}
+    bool gamepad_handle::open(const std::string& path)
+    {
+        if (!m_device.open(path))
+            return false;
+
+        /* Whatever is held down right now */
+        gamepad_state state(m_device.state());
+        update_state(&state);
+        return true;
+    }
 #endif
 
     /* Hook util methods */
@@ -173,9 +195,50 @@ namespace gamepad
 #ifdef _WIN32
         return true; /* On windows we can use hotplug and detect gamepads on the fly */
 #else
+        /* The first CLIENT_PAD_COUNT gamepads among the event devices */
+        std::vector<int> numbers;
+        if (const auto dir = opendir(EVDEV_DIR))
+        {
+            while (const auto entry = readdir(dir))
+            {
+                int number;
+                if (sscanf(entry->d_name, "event%d", &number) == 1)
+                    numbers.emplace_back(number);
+            }
+            closedir(dir);
+        }
+        std::sort(numbers.begin(), numbers.end());
+
+        if (epoll_fd == -1)
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1)
+            return false;
+
+        auto next = pad_handles;
+        for (const auto number : numbers)
+        {
+            if (next == pad_handles + CLIENT_PAD_COUNT)
+                break;
+
+            const auto path = EVDEV_DIR "/event" + std::to_string(number);
+            if (!next->open(path))
+                continue;
+
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.u32 = next->get_id();
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, next->dev().fd(), &ev) == -1)
+            {
+                next->unload();
+                continue;
+            }
+
+            printf("Gamepad %i is %s\n", next->get_id(), path.c_str());
+            next++;
+            flag = true;
+        }
         return flag;
 #endif
-		
 	}
 
 	void close()
@@ -191,53 +254,109 @@ namespace gamepad
         if (!util::cfg.monitor_gamepad)
             return false;
         for (auto& pad : pad_handles)
-            if (pad.m_changed)
+            if (pad.changed())
                 return true;
         return false;
     }
 
+    /* Hands changes to the network thread. Buttons go out right away,
+     * analog changes at most cfg.pad_rate times per second, so stick
+     * noise can't flood the connection. Returns how long to wait until
+     * pending changes may be sent, in ms, or -1 if nothing is pending */
+    static int notify_changes(const bool buttons)
+    {
+        if (!check_changes())
+            return -1;
+
+        const auto now = util::get_time_us();
+        const uint64_t interval = util::cfg.pad_rate ? 1000000 / util::cfg.pad_rate : 0;
+        if (!buttons && now - last_notify < interval)
+            return int((interval - (now - last_notify) + 999) / 1000);
+
+        last_notify = now;
+        network::notify_gamepad();
+        return -1;
+    }
+
 	/* Background process for querying game pads */
 #ifdef _WIN32
 	DWORD WINAPI hook_method(const LPVOID arg)
-#else
-    void* hook_method(void *)
-#endif
     {
         /* The hook only keeps track of the gamepad states here
          * and the changes will then be sent in a different thread
          */
 		while (hook_run_flag)
 		{
-#ifdef _WIN32 /* On linux the check happens inside the for loop */
-            if (network::data_block)
-            {
-                Sleep(25);
-                continue;
-            }
-#endif
+            auto buttons = false;
             for (auto& pad : pad_handles)
             {
                 if (!pad.valid())
                     continue;
-#ifdef _WIN32
+
                 gamepad_state new_state(pad.get_xinput());
-                pad.update_state(&new_state);
-#else
-                /* TODO: Linux implementation */
-#endif
+                buttons = pad.update_state(&new_state) || buttons;
             }
-#ifdef _WIN32
+            notify_changes(buttons);
             Sleep(25);
-#endif
 		}
 
         for (auto& pad : pad_handles)
             pad.unload();
-
-#ifdef _WIN32
 		return 0x0;
+    }
 #else
+    /* Sleeps until a pad sent something or held back
+     * changes may be sent */
+    void* hook_method(void *)
+    {
+        epoll_event events[CLIENT_PAD_COUNT];
+        auto timeout = PAD_POLL_MS;
+
+		while (hook_run_flag)
+		{
+            const auto count = epoll_wait(epoll_fd, events, CLIENT_PAD_COUNT, timeout);
+            if (count == -1 && errno != EINTR)
+            {
+                printf("Waiting for gamepads failed: %s\n", strerror(errno));
+                break;
+            }
+
+            auto buttons = false;
+            for (auto i = 0; i < count; i++)
+            {
+                auto& pad = pad_handles[events[i].data.u32];
+                auto changed = false;
+                if (!pad.valid())
+                    continue;
+
+                if (!pad.dev().read(changed))
+                {
+                    printf("Gamepad %i disconnected\n", pad.get_id());
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pad.dev().fd(), nullptr);
+                    pad.unload();
+
+                    /* Release everything on the other end */
+                    gamepad_state released;
+                    pad.update_state(&released);
+                    buttons = true;
+                }
+                else if (changed)
+                {
+                    gamepad_state new_state(pad.dev().state());
+                    buttons = pad.update_state(&new_state) || buttons;
+                }
+            }
+
+            const auto wait = notify_changes(buttons);
+            timeout = wait < 0 ? PAD_POLL_MS : std::min(wait, PAD_POLL_MS);
+		}
+
+        for (auto& pad : pad_handles)
+            pad.unload();
+        if (epoll_fd != -1)
+            ::close(epoll_fd);
+        epoll_fd = -1;
 		pthread_exit(nullptr);
-#endif
     }
+#endif
 }
@@ -7,10 +7,16 @@
 
 #pragma once
 #include <stdint.h>
+#include <mutex>
 #include "gamepad_state.hpp"
 #include "xinput_fix.hpp"
+#ifndef _WIN32
+#include <pthread.h>
+#include "../../io-obs/hook/evdev_pad.hpp"
+#endif
 
-#define PAD_COUNT 4
+/* Pads the client reads, UDP snapshots have room for this many */
+#define CLIENT_PAD_COUNT    4
 
 namespace gamepad
 {
@@ -20,7 +26,7 @@ namespace gamepad
     extern pthread_t game_pad_hook_thread;
 #endif
     class gamepad_handle;
-    extern gamepad_handle pad_handles[PAD_COUNT];
+    extern gamepad_handle pad_handles[CLIENT_PAD_COUNT];
     extern volatile bool hook_state;
     extern volatile bool hook_run_flag;
 
@@ -43,21 +49,9 @@ namespace gamepad
 		xinput_fix::CODE_START,
 		xinput_fix::CODE_BACK
 	};
-#ifndef _WIN32
-#define ID_TYPE         6
-#define ID_BUTTON       1
-#define ID_STATE_1      4
-#define ID_STATE_2      5
-#define ID_KEY_CODE     7
-#define ID_PRESSED      1
-
-#define ID_L_ANALOG_X   0
-#define ID_L_ANALOG_Y   1
-#define ID_L_TRIGGER    2
-#define ID_R_ANALOG_X   3
-#define ID_R_ANALOG_Y   4
-#define ID_R_TRIGGER    5
-#endif /* !WINDOWS */
+
+/* Longest the pad thread sleeps, so it notices when it should exit */
+#define PAD_POLL_MS     100
 
 	class gamepad_handle
 	{
@@ -74,11 +68,13 @@ namespace gamepad
 
 		uint8_t get_id() const;
 
-        gamepad_state* get_state();
+        /* Called by the pad thread, returns true if a button changed */
+        bool update_state(gamepad_state* new_state);
 
-        void update_state(gamepad_state* new_state);
-
-        bool m_changed = false;
+        /* Called by the network thread. Copies the state and returns true
+         * if it changed since the last call */
+        bool take_changes(gamepad_state& state);
+        bool changed();
 #ifdef _WIN32
 		void update();
 		xinput_fix::gamepad* get_xinput();
@@ -86,15 +82,18 @@ namespace gamepad
 		xinput_fix::gamepad m_x_input = {};
 		bool m_valid = false;
 #else
-		FILE* dev();
-
+		/* False if path isn't a gamepad */
+		bool open(const std::string& path);
+		evdev::device& dev() { return m_device; }
 	private:
-		FILE* m_device_file = nullptr;
-		std::string m_path;
+		evdev::device m_device;
 #endif
 		int8_t m_pad_id = -1;
+
+		/* Shared by the pad and the network thread */
+		std::mutex m_state_lock;
 		gamepad_state m_current_state;
-        
+		bool m_changed = false;
     };
 
     /* Thread stuff*/
@@ -5,14 +5,37 @@
  * github.com/univrsal/input-overlay
  */
 
+#include <cmath>
+#include <cstdlib>
 #include "gamepad_state.hpp"
 #include "xinput_fix.hpp"
 #include "../../io-obs/util/layout_constants.hpp"
 #define IO_CLIENT 1 /* Prevents external util.hpp from including obs headers */
 #include "../../io-obs/util/util.hpp"
+#include "util.hpp"
 
 namespace gamepad
 {
+    static void apply_deadzone(float& x, float& y, const float deadzone)
+    {
+        if (x * x + y * y < deadzone * deadzone)
+            x = y = 0.f;
+    }
+
+    /* Coming back to rest is always sent, even if it's a small step */
+    static bool axis_moved(const float old_value, const float new_value)
+    {
+        return std::fabs(new_value - old_value) > util::cfg.pad_epsilon
+            || (new_value == 0.f && old_value != 0.f);
+    }
+
+    static bool trigger_moved(const int8_t old_value, const int8_t new_value)
+    {
+        /* Both are really unsigned, see gamepad_state(xinput_fix::gamepad*) */
+        const auto delta = std::abs(int(uint8_t(new_value)) - int(uint8_t(old_value)));
+        return delta > util::cfg.pad_epsilon * 255.f || (!new_value && old_value);
+    }
+
 	gamepad_state::gamepad_state()
 	{
 		button_states = 0x0;
@@ -21,6 +44,7 @@ namespace gamepad
 		trigger_l = trigger_r = 0;
 	}
 
+#ifdef _WIN32
     gamepad_state::gamepad_state(xinput_fix::gamepad* pad)
     {
         if (pad)
@@ -37,31 +61,37 @@ namespace gamepad
             trigger_r = pad->bRightTrigger;
         }
     }
+#else
+    gamepad_state::gamepad_state(const recording::xinput_sample& sample)
+    {
+        button_states = int16_t(sample.buttons);
+        stick_l_x = sample.left_x / SAMPLE_STICK_MAX;
+        stick_l_y = sample.left_y / SAMPLE_STICK_MAX;
+        stick_r_x = sample.right_x / SAMPLE_STICK_MAX;
+        stick_r_y = sample.right_y / SAMPLE_STICK_MAX;
+        trigger_l = int8_t(sample.left_trigger);
+        trigger_r = int8_t(sample.right_trigger);
+    }
+#endif
 
     bool gamepad_state::merge(gamepad_state* new_state)
     {
 		if (!new_state)
 			return false;
-        auto merged = false;
-#ifdef _WIN32 
-	    /* On windows the new state contains all changes -> No merging needed*/
-        if (new_state->button_states != button_states)
-            merged = true;
-        /* TODO: Maybe use deadzone here 
-         * Right now even the slightest movement results in updates
-         */
-        else if (new_state->stick_l_x != stick_l_x) 
-            merged = true;                           
-        else if (new_state->stick_l_y != stick_l_y)
-            merged = true;
-        else if (new_state->stick_r_x != stick_r_x)
-            merged = true;
-        else if (new_state->stick_r_y != stick_r_y)
-            merged = true;
-        else if (new_state->trigger_l != trigger_l)
-            merged = true;
-        else if (new_state->trigger_r != trigger_r)
-            merged = true;
+
+        /* xinput and the evdev reader both deliver complete states */
+        apply_deadzone(new_state->stick_l_x, new_state->stick_l_y, util::cfg.deadzone_l);
+        apply_deadzone(new_state->stick_r_x, new_state->stick_r_y, util::cfg.deadzone_r);
+
+        /* Noise is compared against the last sent state, so slow
+         * movements still add up to an update */
+        const auto merged = new_state->button_states != button_states
+            || axis_moved(stick_l_x, new_state->stick_l_x)
+            || axis_moved(stick_l_y, new_state->stick_l_y)
+            || axis_moved(stick_r_x, new_state->stick_r_x)
+            || axis_moved(stick_r_y, new_state->stick_r_y)
+            || trigger_moved(trigger_l, new_state->trigger_l)
+            || trigger_moved(trigger_r, new_state->trigger_r);
 
         if (merged)
         {
@@ -73,10 +103,6 @@ namespace gamepad
             trigger_l = new_state->trigger_l;
             trigger_r = new_state->trigger_r;
         }
-#else   /* On linux old values should be kept and if needed overridden by new ones */
-
-        /*TODO: implementation*/
-#endif
 
 		return merged;
 	}
@@ -8,6 +8,15 @@
 #pragma once
 #include <cstdint>
 #include "xinput_fix.hpp"
+#ifndef _WIN32
+#include "../../io-obs/hook/evdev_pad.hpp"
+#endif
+
+/* Defaults of the --deadzone and --epsilon options. Sticks closer to
+ * the center than the deadzone are reported as centered, smaller
+ * changes than epsilon are treated as noise and not sent */
+#define STICK_DEADZONE      0.05f
+#define PAD_EPSILON         0.01f
 
 namespace gamepad
 {
@@ -19,8 +28,10 @@ namespace gamepad
 #ifdef _WIN32
 	    explicit gamepad_state(xinput_fix::gamepad* pad);
 #else
-        /* Linux constructor */
+        explicit gamepad_state(const recording::xinput_sample& sample);
 #endif
+	    /* Takes over new_state if it differs by more than noise,
+	     * returns true if it did */
 	    bool merge(gamepad_state* new_state);
 
 		int16_t button_states;
@@ -9,12 +9,11 @@
 #include <cstdarg>
 #include <cstdio>
 #include "network.hpp"
+#include "util.hpp"
 #include "gamepad.hpp"
 
 namespace hook
 {
-    uiohook_event* last_event = nullptr; /* Copy of last event */
-    volatile bool new_event = false;
     volatile bool hook_state = false;
 
     bool logger_proc(unsigned level, const char* format, ...)
@@ -55,30 +54,18 @@ namespace hook
         case EVENT_HOOK_DISABLED:
             printf("uiohook exited\n");
             break;
-        case EVENT_KEY_TYPED:
-        case EVENT_KEY_PRESSED:
-        case EVENT_KEY_RELEASED:
-        case EVENT_MOUSE_CLICKED:
-        case EVENT_MOUSE_PRESSED:
-        case EVENT_MOUSE_RELEASED:
-        case EVENT_MOUSE_MOVED:
-        case EVENT_MOUSE_DRAGGED:
-        case EVENT_MOUSE_WHEEL:
-            /* Received event */
-            if (!network::data_block)
-            {
-                network::data_to_send = true;
-                new_event = true;
-                *last_event = *event;
-            }
-            break;
-        default:;
+        default:
+        {
+            /* Received event, the network thread sends it with the next batch */
+            network::frame_event e = {};
+            if (util::to_frame_event(event, e))
+                network::queue_event(e, util::get_time_us());
+        }
         }
 	}
 
     bool init()
     {
-        last_event = new uiohook_event(); /* Allocate memory for copy of last event */
 		hook_set_logger_proc(&logger_proc);
     	hook_set_dispatch_proc(&dispatch_proc);
 
@@ -139,8 +126,6 @@ namespace hook
             return;
 
 		const auto status = hook_stop();
-        delete last_event;
-        last_event = nullptr;
 
 		printf("Closing hook\n");
 		switch (status)
@@ -10,8 +10,6 @@
 
 namespace hook
 {
-    extern uiohook_event* last_event;
-    extern volatile bool new_event;
     extern volatile bool hook_state;
 	bool logger_proc(unsigned level, const char* format, ...);
 
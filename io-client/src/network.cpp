@@ -10,8 +10,21 @@
 #include "util.hpp"
 #include <cstdio>
 #include "gamepad.hpp"
+#include "snapshot.hpp"
+#include "../../io-obs/util/spsc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
 #ifdef UNIX
 #include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#else
+#include <winsock2.h>
 #endif
 
 namespace network
@@ -19,10 +32,179 @@ namespace network
 	tcp_socket sock = nullptr;
 	netlib_socket_set set = nullptr;
     volatile bool network_loop = true;
-    netlib_byte_buf* buffer = nullptr;
+    frame_writer frame;
+    hello agreed;
+
+    /* Event as the hook saw it, the frame only stores an offset */
+    struct queued_event
+    {
+        uint64_t time;
+        frame_event event;
+    };
+
+    /* The hook thread pushes, the network thread drains. The lock and
+     * condition variable are only used to sleep while nothing's queued */
+    static spsc_queue<queued_event, EVENT_QUEUE_SIZE> event_queue;
+    static std::atomic<uint32_t> queued{0};
+    static std::atomic<bool> pad_changes{false};
+    static std::mutex signal_lock;
+    static std::condition_variable signal;
+
+    /* UDP mode, the TCP socket is then only used for the name,
+     * the session id, keep-alives and messages from the server */
+    static udp_socket udp_sock = nullptr;
+    static udp_packet* datagram = nullptr;
+    static int udp_channel = -1;
+    static uint32_t udp_session = 0;
+    static uint64_t last_datagram = 0;
+    static uint32_t frames_sent = 0;    /* Counted by send_frame() */
+    static input_snapshot snapshot;
+
+    /* netlib doesn't expose the native handle, but its sockets are
+     * SDL_net's: The ready flag (see netlib_generic_socket) is
+     * followed by the handle */
+    struct netlib_tcp_layout
+    {
+        int ready;
+#ifdef _WIN32
+        SOCKET channel;
+#else
+        int channel;
+#endif
+    };
+
+    static bool set_no_delay(tcp_socket socket)
+    {
+        const int flag = 1;
+        const auto handle = reinterpret_cast<netlib_tcp_layout*>(socket)->channel;
+        return setsockopt(handle, IPPROTO_TCP, TCP_NODELAY,
+            reinterpret_cast<const char*>(&flag), sizeof(flag)) == 0;
+    }
+
+    static void wake()
+    {
+        std::lock_guard<std::mutex> lock(signal_lock);
+        signal.notify_one();
+    }
+
+    /* Reads exactly length bytes, the server answers right away */
+    static bool receive(uint8_t* data, const int length)
+    {
+        auto read = 0;
+        while (read < length)
+        {
+            if (netlib_check_socket_set(set, HANDSHAKE_TIMEOUT_MS) <= 0)
+                return false;
+
+            const auto result = netlib_tcp_recv(sock, data + read, length - read);
+            if (result <= 0)
+                return false;
+            read += result;
+        }
+        return true;
+    }
+
+    /* Sends our hello with the name and reads what the server agreed on */
+    static bool exchange_hello()
+    {
+        uint8_t data[FRAME_HEADER_SIZE + HELLO_SIZE + HELLO_MAX_NAME];
+        char name[HELLO_MAX_NAME + 1];
+        frame_header header;
+        hello own;
+
+        own.caps = CAP_ALL;
+        own.pads = CLIENT_PAD_COUNT;
+
+        const auto size = write_hello(data, MSG_HELLO, own, util::cfg.username, util::get_time_us());
+        if (netlib_tcp_send(sock, data, int(size)) != int(size))
+        {
+            printf("Failed to send hello: %s\n", netlib_get_error());
+            return false;
+        }
+
+        /* Servers from before the hello close the connection */
+        if (!receive(data, FRAME_HEADER_SIZE) || !read_any_frame_header(data, header) ||
+            header.length > HELLO_SIZE + HELLO_MAX_NAME ||
+            !receive(data + FRAME_HEADER_SIZE, header.length) ||
+            !read_hello(data + FRAME_HEADER_SIZE, header, agreed, name))
+        {
+            printf("Server didn't answer the hello, it might be too old for this io-client.\n");
+            return false;
+        }
+
+        if (header.msg == MSG_VERSION_UNSUPPORTED)
+        {
+            printf("Server doesn't support protocol version %i anymore, io-client has to be updated.\n",
+                FRAME_VERSION);
+            return false;
+        }
+
+        if (header.msg != MSG_HELLO || agreed.version < FRAME_MIN_VERSION)
+        {
+            printf("Server uses protocol version %i, at least %i is needed.\n", agreed.version,
+                FRAME_MIN_VERSION);
+            return false;
+        }
 
-    volatile bool data_to_send = false;
-    volatile bool data_block = false;
+        frame.pads().set_relative(agreed.has(CAP_COMPRESSION));
+        if (!agreed.has(CAP_BATCHING))
+            frame.set_max_events(1);
+        return true;
+    }
+
+    /* Answers the server's clock pings with our clock,
+     * so it knows when events happened */
+    static bool sync_clock()
+    {
+        for (auto i = 0; i < SYNC_ROUNDS; i++)
+        {
+            const auto msg = util::recv_msg();
+            if (msg != MSG_TIME_SYNC)
+            {
+                printf("Expected clock ping, got message %i\n", msg);
+                return false;
+            }
+
+            if (!send_message(MSG_TIME_SYNC))
+                return false;
+        }
+        return true;
+    }
+
+    /* Opens the UDP socket and tells the server which
+     * session id the datagrams will carry */
+    static bool start_udp()
+    {
+        udp_sock = netlib_udp_open(0);
+        datagram = netlib_alloc_packet(UDP_MAX_PACKET);
+
+        if (!udp_sock || !datagram)
+        {
+            printf("Opening UDP socket failed: %s\n", netlib_get_error());
+            return false;
+        }
+
+        udp_channel = netlib_udp_bind(udp_sock, -1, &util::cfg.ip);
+        if (udp_channel == -1)
+        {
+            printf("netlib_udp_bind failed: %s\n", netlib_get_error());
+            return false;
+        }
+
+        /* Only has to be unlikely to collide with other clients, 0 means no session */
+        std::random_device random;
+        std::mt19937 gen(random() ^ uint32_t(util::get_time_us()));
+        do
+            udp_session = gen();
+        while (!udp_session);
+
+        frame_event e = {};
+        e.kind = MSG_UDP_SESSION;
+        e.session = udp_session;
+        frame.begin(MSG_EVENT_FRAME, util::get_time_us());
+        frame.add(e);
+        return send_frame();
+    }
 
 #ifdef _WIN32
 	static HANDLE network_thread;
@@ -61,14 +243,32 @@ namespace network
         }
 
 		printf("Connection successful!\n");
+
+		/* netlib usually disables Nagle's algorithm already, but
+		 * batches are sent as soon as they're done, so make sure */
+		if (!set_no_delay(sock))
+			printf("Couldn't set TCP_NODELAY, input might be delayed\n");
         
-		/* Send client name */
-		if (!util::send_text(util::cfg.username))
+		if (!exchange_hello())
+			return false;
+
+        if (agreed.has(CAP_TIMESTAMPS) && !sync_clock())
         {
-			printf("Failed to send username (%s): %s\n", util::cfg.username, netlib_get_error());
+			printf("Clock synchronization with the server failed.\n");
 			return false;
         }
 
+        if (util::cfg.use_udp && !agreed.has(CAP_UDP))
+        {
+            printf("Server doesn't accept UDP, sending input over TCP.\n");
+        }
+        else if (util::cfg.use_udp)
+        {
+            if (!start_udp())
+                return false;
+            printf("Sending input over UDP.\n");
+        }
+
         if (!start_thread())
         {
 			printf("Failed to create network thread.\n");
@@ -88,86 +288,175 @@ namespace network
 		return pthread_create(&network_thread, nullptr, network_thread_method, nullptr) == 0;
 #endif
     }
-	uint32_t last_message = 0;
+	uint64_t last_message = 0;
+
+    /* Sleeps until a batch is ready or the server has to hear from us */
+    static void wait_for_batch()
+    {
+        const auto timeout = udp_sock ? UDP_RESEND_MS : LISTEN_TIMEOUT;
+        std::unique_lock<std::mutex> lock(signal_lock);
+        signal.wait_for(lock, std::chrono::milliseconds(timeout), []
+        {
+            return queued.load() || pad_changes.load() || !network_loop;
+        });
+
+        /* Give the events that come right after this one a chance
+         * to end up in the same frame */
+        if (agreed.has(CAP_BATCHING) && queued.load() && queued.load() < BATCH_EVENTS)
+        {
+            signal.wait_for(lock, std::chrono::microseconds(BATCH_WINDOW_US), []
+            {
+                return queued.load() >= BATCH_EVENTS || !network_loop;
+            });
+        }
+    }
+
+    /* Sends everything queued so far, usually in one frame. sent is set
+     * if anything went out, pads the server doesn't know about and pads
+     * that didn't change are left out, which can leave nothing to send */
+    static bool send_batch(bool& sent)
+    {
+        const auto frames = frames_sent;
+        auto result = true;
+        auto first = true;
+
+        const auto count = event_queue.drain([&](const queued_event& q)
+        {
+            if (first)
+            {
+                frame.begin(MSG_EVENT_FRAME, q.time);
+                first = false;
+            }
+
+            auto e = q.event;
+            e.time = uint32_t(q.time - frame.time());
+            if (!frame.add(e))
+            {
+                /* Full, send it and start the next one */
+                result = send_frame() && result;
+                frame.begin(MSG_EVENT_FRAME, q.time);
+                e.time = 0;
+                frame.add(e);
+            }
+        });
+        queued -= uint32_t(count);
+
+        if (first)
+            frame.begin(MSG_EVENT_FRAME, util::get_time_us());
+
+        if (pad_changes.exchange(false) && gamepad::check_changes())
+        {
+            if (frame.free_space() < CLIENT_PAD_COUNT * (EVENT_HEADER_SIZE + GAMEPAD_EVENT_MAX_SIZE))
+            {
+                result = send_frame() && result;
+                frame.begin(MSG_EVENT_FRAME, util::get_time_us());
+            }
+
+            result = util::write_gamepad_data() && result;
+        }
+
+#ifdef _DEBUG /* Visualize gamepad data */
+        util::to_bits(frame.size(), frame.data());
+#endif
+        if (frame.count())
+            result = send_frame() && result;
+        sent = frames_sent != frames;
+        return result;
+    }
+
+    /* UDP mode: Puts everything queued so far into the state and
+     * sends all of it in one datagram */
+    static bool send_snapshot()
+    {
+        auto changed = false;
+
+        const auto count = event_queue.drain([&](const queued_event& q)
+        {
+            changed = snapshot.apply(q.event) || changed;
+        });
+        queued -= uint32_t(count);
+
+        if (pad_changes.exchange(false) && gamepad::check_changes())
+        {
+            frame_event e = {};
+            for (auto& pad : gamepad::pad_handles)
+            {
+                gamepad::gamepad_state state;
+                if (pad.take_changes(state) && pad.get_id() < agreed.pads)
+                {
+                    util::write_padstate(e, pad.get_id(), &state);
+                    snapshot.set_pad(e);
+                    changed = true;
+                }
+            }
+        }
+
+        const auto now = util::get_time_us();
+        if (!changed && now - last_datagram < UDP_RESEND_MS * 1000)
+            return true;
+
+        datagram->len = int(snapshot.write(datagram->data, udp_session, now));
+        last_datagram = now;
+        return netlib_udp_send(udp_sock, udp_channel, datagram) == 1;
+    }
+
 #ifdef _WIN32
 	DWORD WINAPI network_thread_method(const LPVOID arg)
 #else
 	void* network_thread_method(void *)
 #endif
 	{
-		last_message = util::get_ticks();
+		last_message = util::get_time_us();
 
         while (network_loop)
         {
-            if (!listen()) /* Has a timeout of 100ms*/
+            wait_for_batch();
+
+            if (!listen(0))
             {
 				printf("Received quit signal\n");
 				break;
             }
 
-            /* If any data is ready send it */
-            if (data_to_send)
+            if (udp_sock)
             {
-                data_block = true;
-                
-                /* First write pending data */
-                if (gamepad::check_changes() && !util::write_gamepad_data())
-                {
-                    printf("Failed to write gamepad event data to buffer. Exiting...\n");
-                    break;
-                }
-
-#ifdef _DEBUG /* Visualize gamepad data */
-                util::to_bits(network::buffer->write_pos, network::buffer);
-#endif
-                if (hook::new_event)
-                    util::write_uiohook_event(hook::last_event);
-                
-                if (!netlib_tcp_send_buf_smart(sock, buffer))
-                {
-                    DEBUG_LOG("netlib_tcp_send_buf_smart: %s\n", netlib_get_error());
-                    //break;
-                }
-
-                data_block = false;
-                data_to_send = false;
-                hook::new_event = false;
-                //last_message = util::get_ticks();
-                buffer->write_pos = 0;
+                if (!send_snapshot())
+                    DEBUG_LOG("netlib_udp_send: %s\n", netlib_get_error());
             }
-            /* About to timeout -> tell server we're still here */
-            else if (util::get_ticks() - last_message > DC_TIMEOUT)
+            else if (queued.load() || pad_changes.load())
             {
-                buffer->write_pos = 0;
-
-				if (!netlib_write_uint8(buffer, MSG_PREVENT_TIMEOUT))
-				{
-					DEBUG_LOG("netlib_write_uint8: %s\n", netlib_get_error());
-					break;
-				}
+                /* Only a frame that went out postpones the keep-alive */
+                auto sent = false;
+                if (!send_batch(sent))
+                    DEBUG_LOG("netlib_tcp_send: %s\n", netlib_get_error());
+                if (sent)
+                    last_message = util::get_time_us();
+            }
 
-				if (!netlib_tcp_send_buf_smart(sock, buffer))
+            /* About to timeout -> tell server we're still here. Datagrams
+             * don't count, the server only keeps track of the TCP connection */
+            if (util::get_time_us() - last_message > DC_TIMEOUT * 1000)
+            {
+				if (!send_message(MSG_PREVENT_TIMEOUT))
 				{
-                    DEBUG_LOG("netlib_tcp_send_buf_smart: %s\n", netlib_get_error());
+                    DEBUG_LOG("netlib_tcp_send: %s\n", netlib_get_error());
 					break;
 				}
-                printf("yezsz\n");
-				last_message = util::get_ticks();
+				last_message = util::get_time_us();
             }
         }
 
         DEBUG_LOG("Network loop exited\n");
 
         /* Tell server we're disconnecting */
-        buffer->write_pos = 0;
-        netlib_write_uint8(buffer, MSG_CLIENT_DC);
-        netlib_tcp_send_buf_smart(sock, buffer);
+        send_message(MSG_CLIENT_DC);
 
         if (sock)
             netlib_tcp_close(sock);
-
-        if (buffer)
-            netlib_free_byte_buf(buffer);
+        if (udp_sock)
+            netlib_udp_close(udp_sock);
+        if (datagram)
+            netlib_free_packet(datagram);
 
         netlib_quit();
         util::close_all();
@@ -180,9 +469,9 @@ namespace network
 	}
 
 	int numready = 0;
-    bool listen()
+    bool listen(const uint32_t timeout)
     {
-		numready = netlib_check_socket_set(set, LISTEN_TIMEOUT);
+		numready = netlib_check_socket_set(set, timeout);
 
 		if (numready == -1)
 		{
@@ -224,18 +513,48 @@ namespace network
 			return false;
 		}
 
-		buffer = netlib_alloc_byte_buf(BUFFER_SIZE);
-
-        if (!buffer)
-        {
-            DEBUG_LOG("netlib_alloc_byte_buf failed: %s\n", netlib_get_error());
-			return false;
-        }
 		return true;
     }
 
+    bool send_frame()
+    {
+        frame.finish();
+        if (netlib_tcp_send(sock, frame.data(), int(frame.size())) != int(frame.size()))
+            return false;
+        frames_sent++;
+        return true;
+    }
+
+    bool send_message(const message msg)
+    {
+        frame.begin(msg, util::get_time_us());
+        return send_frame();
+    }
+
+    void queue_event(const frame_event& event, const uint64_t time)
+    {
+        /* Every event has to arrive, so wait for the network thread
+         * instead of dropping it. Batches are sent every millisecond,
+         * so the ring should never actually fill up */
+        const auto count = ++queued; /* Before the push, so drains never count below zero */
+        while (!event_queue.push({time, event}) && network_loop)
+            std::this_thread::yield();
+
+        /* Only the first event of a batch and a full batch wake the
+         * network thread, everything in between is free */
+        if (count == 1 || count == BATCH_EVENTS)
+            wake();
+    }
+
+    void notify_gamepad()
+    {
+        pad_changes = true;
+        wake();
+    }
+
 	void close()
 	{
         network_loop = false;
+        wake();
 	}
 }
@@ -11,29 +11,50 @@
 #include <Windows.h>
 #endif
 #include "util.hpp"
+#include "../../io-obs/network/protocol.hpp"
 
- /* We need 90 bytes if all four gamepads are sent + 5 bytes for a mouse event
-  * (Mouse event is the largest uiohook event)
-  */
-#define BUFFER_SIZE     90
 #define LISTEN_TIMEOUT  100
 /* Can't wait exactly 1000ms because the server times clients out at 1000ms*/
 #define DC_TIMEOUT      (1000 - LISTEN_TIMEOUT)
 
+/* Events are sent once this many are queued or the oldest one waited
+ * BATCH_WINDOW_US, whichever comes first */
+#define BATCH_EVENTS    64
+#define BATCH_WINDOW_US 1000
+/* Has to be a power of two */
+#define EVENT_QUEUE_SIZE 1024
+/* In UDP mode the state is sent again after this long without changes,
+ * so a lost datagram is corrected quickly */
+#define UDP_RESEND_MS   50
+
 namespace network
 {
 	extern tcp_socket sock;
 	extern netlib_socket_set set;
 	extern volatile bool network_loop;
-    extern volatile bool data_to_send;  /* Set to true by other threads */
-    extern volatile bool data_block;    /* Set to true to prevent other threads from modifying data, which is about to be sent */
-	extern uint32_t last_message;       /* Keeps track of timeout */
-	extern netlib_byte_buf* buffer;     /* Shared buffer for writing data, which will be sent to the server */
+	extern uint64_t last_message;       /* Keeps track of timeout */
+	extern frame_writer frame;          /* Frame that is filled with events and then sent to the server */
+	extern hello agreed;                /* What both ends support, set by the handshake */
+
 	
 	bool init();
 	bool start_connection();
 	bool start_thread();
-	bool listen();
+	/* Checks for messages from the server, false if the connection should close */
+	bool listen(uint32_t timeout);
+
+	/* Called by the hook thread. Queues an event for the next batch,
+	 * time is util::get_time_us() at the time of the event */
+	void queue_event(const frame_event& event, uint64_t time);
+
+	/* Called by the gamepad thread, wakes the network thread so the changes are sent */
+	void notify_gamepad();
+
+	/* Sends the frame started with frame.begin() */
+	bool send_frame();
+
+	/* Sends a frame without events */
+	bool send_message(message msg);
 
 #ifdef _WIN32
 	DWORD WINAPI network_thread_method(LPVOID arg);
@@ -0,0 +1,92 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "snapshot.hpp"
+#include <algorithm>
+
+namespace network
+{
+	bool input_snapshot::apply(const frame_event& event)
+	{
+		auto& s = m_state;
+
+		switch (event.kind)
+		{
+		case MSG_BUTTON_DATA:
+		{
+			const auto key = std::find(m_keys.begin(), m_keys.end(), event.code);
+			if (event.state)
+			{
+				if (key == m_keys.end())
+					m_keys.emplace_back(event.code);
+			}
+			else if (key != m_keys.end())
+			{
+				m_keys.erase(key);
+			}
+			add_change(event.code, event.state);
+			return true;
+		}
+		case MSG_MOUSE_POS_DATA:
+			if (s.mouse_x == event.x && s.mouse_y == event.y)
+				return false;
+			s.mouse_x = event.x;
+			s.mouse_y = event.y;
+			return true;
+		case MSG_GAMEPAD_DATA:
+			set_pad(event);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void input_snapshot::set_pad(const frame_event& event)
+	{
+		if (event.pad < UDP_MAX_PADS)
+		{
+			m_pads[event.pad] = true;
+			m_state.pads[event.pad] = event;
+		}
+	}
+
+	size_t input_snapshot::write(uint8_t* out, const uint32_t session, const uint64_t time)
+	{
+		auto s = m_state;
+		s.session = session;
+		s.sequence = ++m_state.sequence;
+		s.time = time;
+
+		/* Keys beyond the limit only show up through the history,
+		 * the flag keeps the server from releasing them */
+		s.key_count = uint8_t(std::min<size_t>(m_keys.size(), UDP_MAX_KEYS));
+		s.keys_truncated = m_keys.size() > UDP_MAX_KEYS;
+		std::copy(m_keys.begin(), m_keys.begin() + s.key_count, s.keys);
+
+		/* Only pads that were seen, in order */
+		s.pad_count = 0;
+		for (auto i = 0; i < UDP_MAX_PADS; i++)
+		{
+			if (m_pads[i])
+				s.pads[s.pad_count++] = m_state.pads[i];
+		}
+
+		/* Oldest change first, so the server applies them in order */
+		const auto count = std::min<uint32_t>(m_changes, UDP_HISTORY);
+		s.history_count = uint8_t(count);
+		for (uint32_t i = 0; i < count; i++)
+			s.history[i] = m_history[(m_changes - count + i + 1) % UDP_HISTORY];
+
+		return write_snapshot(s, out);
+	}
+
+	void input_snapshot::add_change(const uint16_t code, const uint8_t state)
+	{
+		++m_changes;
+		m_history[m_changes % UDP_HISTORY] = {m_changes, code, state};
+	}
+}
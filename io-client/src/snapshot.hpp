@@ -0,0 +1,43 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "../../io-obs/network/protocol.hpp"
+
+namespace network
+{
+	/**
+	 * Input state of this client as it is sent in UDP mode.
+	 * Every datagram contains all of it, plus the last few
+	 * button changes in case datagrams in between got lost.
+	 * Only used by the network thread
+	 */
+	class input_snapshot
+	{
+	public:
+		/* Returns true if the state changed */
+		bool apply(const frame_event& event);
+
+		/* Stores the latest state of a pad, event is a MSG_GAMEPAD_DATA event */
+		void set_pad(const frame_event& event);
+
+		/* Writes the next datagram, out has to hold UDP_MAX_PACKET bytes.
+		 * Returns its size */
+		size_t write(uint8_t* out, uint32_t session, uint64_t time);
+	private:
+		void add_change(uint16_t code, uint8_t state);
+
+		udp_snapshot m_state = {};
+		std::vector<uint16_t> m_keys;       /* All pressed keys, in the order they were pressed */
+		bool m_pads[UDP_MAX_PADS] = {};     /* Pads that reported their state at least once */
+
+		button_change m_history[UDP_HISTORY] = {};
+		uint32_t m_changes = 0;             /* Number of the last change */
+	};
+}
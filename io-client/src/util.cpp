@@ -9,6 +9,7 @@
 #include <cstdlib>
 #include "network.hpp"
 #include <string>
+#include <chrono>
 #include "gamepad.hpp"
 #include "hook.hpp"
 #ifdef _WIN32
@@ -25,6 +26,16 @@ namespace util
 {
 	config cfg;
 
+	/* Value after '=' if it's within 0 - 1, otherwise fallback */
+	static float unit_value(const std::string& arg, const float fallback)
+	{
+		const auto value = strtof(arg.c_str() + arg.find('=') + 1, nullptr);
+		if (value >= 0.f && value <= 1.f)
+			return value;
+		printf("%s is outside the valid range [0 - 1]\n", arg.c_str());
+		return fallback;
+	}
+
 	bool parse_arguments(int argc, char ** args)
 	{
 		if (argc < 3)
@@ -37,12 +48,22 @@ namespace util
 			printf(" --gamepad=1   enable/disable gamepad monitoring. Off by default\n");
 			printf(" --mouse=1     enable/disable mouse monitoring.  Off by default\n");
 			printf(" --keyboard=1  enable/disable keyboard monitoring. On by default\n");
+			printf(" --udp=1       send input over UDP, lost packets don't delay later input. Off by default\n");
+			printf(" --deadzone=x  stick deadzone from 0 to 1, default is %.2f\n", STICK_DEADZONE);
+			printf("               --deadzone-l=x and --deadzone-r=x set it for one stick\n");
+			printf(" --epsilon=x   smaller stick and trigger changes aren't sent, default is %.2f\n", PAD_EPSILON);
+			printf(" --pad-rate=n  gamepad updates sent per second, buttons are always sent right away.\n");
+			printf("               Default is %i, 0 disables the limit\n", PAD_RATE);
 			return false;
 		}
 
 		cfg.monitor_gamepad = false;
 		cfg.monitor_keyboard = true;
 		cfg.monitor_mouse = false;
+		cfg.use_udp = false;
+		cfg.deadzone_l = cfg.deadzone_r = STICK_DEADZONE;
+		cfg.pad_epsilon = PAD_EPSILON;
+		cfg.pad_rate = PAD_RATE;
 		cfg.port = 1608;
 
 		auto const s = sizeof(cfg.username);
@@ -77,167 +98,108 @@ namespace util
                  cfg.monitor_mouse = arg.find('1') != std::string::npos;
              else if (arg.find("--keyboard") != std::string::npos)
                  cfg.monitor_keyboard = arg.find('1') != std::string::npos;
+             else if (arg.find("--udp") != std::string::npos)
+                 cfg.use_udp = arg.find('1') != std::string::npos;
+             else if (arg.find("--deadzone-l=") == 0)
+                 cfg.deadzone_l = unit_value(arg, cfg.deadzone_l);
+             else if (arg.find("--deadzone-r=") == 0)
+                 cfg.deadzone_r = unit_value(arg, cfg.deadzone_r);
+             else if (arg.find("--deadzone=") == 0)
+                 cfg.deadzone_l = cfg.deadzone_r = unit_value(arg, cfg.deadzone_l);
+             else if (arg.find("--epsilon=") == 0)
+                 cfg.pad_epsilon = unit_value(arg, cfg.pad_epsilon);
+             else if (arg.find("--pad-rate=") == 0)
+                 cfg.pad_rate = uint16_t(strtoul(arg.c_str() + arg.find('=') + 1, nullptr, 10));
         }
 
 		return true;
     }
 
-	/* https://www.libsdl.org/projects/SDL_net/docs/demos/tcputil.h */
-	int send_text(char* buf)
-	{
-		uint32_t len, result;
-
-		if (!buf || !strlen(buf))
-			return 1;
-
-		len = strlen(buf) + 1;
-		len = netlib_swap_BE32(len);
-
-		result = netlib_tcp_send(network::sock, &len, sizeof(len));
-		if (result < sizeof(len))
-		{
-			if (netlib_get_error() && strlen(netlib_get_error()))
-			{
-				printf("netlib_tcp_send failed: %s\n", netlib_get_error());
-				return 0;
-			}
-		}
-
-		len = netlib_swap_BE32(len);
-
-		result = netlib_tcp_send(network::sock, buf, len);
-		if (result < len)
-		{
-			if (netlib_get_error() && strlen(netlib_get_error()))
-			{
-			    printf("netlib_tcp_send failed: %s\n", netlib_get_error());
-				return 0;
-			}
-		}
-
-		return result;
-	}
-
-    int write_uiohook_event(uiohook_event* const event)
+    bool to_frame_event(const uiohook_event* const event, network::frame_event& e)
     {
-		if (!event)
-			return -1;
-		auto result = 1;
-		auto send = false;
-
 		switch(event->type)
         {
 		case EVENT_KEY_PRESSED:
-            if (cfg.monitor_keyboard)
-            {
-				result = netlib_write_uint8(network::buffer, MSG_BUTTON_DATA)
-					&& write_keystate(network::buffer, event->data.keyboard.keycode, true);
-				send = true;
-            }
-			break;
 		case EVENT_KEY_RELEASED:
-			if (cfg.monitor_keyboard)
-			{
-				result = netlib_write_uint8(network::buffer, MSG_BUTTON_DATA)
-					&& write_keystate(network::buffer, event->data.keyboard.keycode, false);
-				send = true;
-			}
-			break;
+            if (!cfg.monitor_keyboard)
+				return false;
+			write_keystate(e, event->data.keyboard.keycode, event->type == EVENT_KEY_PRESSED);
+			return true;
         case EVENT_MOUSE_PRESSED:
-			if (cfg.monitor_mouse)
-			{
-				result = netlib_write_uint8(network::buffer, MSG_BUTTON_DATA)
-					&& write_keystate(network::buffer, event->data.mouse.button, true);
-				send = true;
-			}
-            break;
         case EVENT_MOUSE_RELEASED:
-			if (cfg.monitor_mouse)
-			{
-				result = netlib_write_uint8(network::buffer, MSG_BUTTON_DATA)
-					&& write_keystate(network::buffer, event->data.mouse.button, false);
-				send = true;
-			}
-            break;
+			if (!cfg.monitor_mouse)
+				return false;
+			write_keystate(e, event->data.mouse.button, event->type == EVENT_MOUSE_PRESSED);
+			return true;
         case EVENT_MOUSE_MOVED:
         case EVENT_MOUSE_DRAGGED:
-			if (cfg.monitor_mouse)
-			{
-				result = netlib_write_uint8(network::buffer, MSG_MOUSE_POS_DATA)
-					&& netlib_write_int16(network::buffer, event->data.mouse.x)
-					&& netlib_write_int16(network::buffer, event->data.mouse.y);
-			}
-            break;
-        default: ;
+			if (!cfg.monitor_mouse)
+				return false;
+			e.kind = MSG_MOUSE_POS_DATA;
+			e.x = event->data.mouse.x;
+			e.y = event->data.mouse.y;
+			return true;
+        default:
+			return false;
         }
-
-		if (!result)
-		{
-            printf("Writing event data to buffer failed: %s\n", netlib_get_error());
-            close_all();
-		}
-
-		return send;
     }
 
     int write_gamepad_data()
     {
         auto result = 1;
-        netlib_write_uint8(network::buffer, MSG_GAMEPAD_DATA);
+        network::frame_event e = {};
+        e.kind = MSG_GAMEPAD_DATA;
+        e.time = uint32_t(get_time_us() - network::frame.time());
+
         for (auto& pad : gamepad::pad_handles)
         {
-            if (pad.m_changed)
+            /* Pads the server doesn't know about are left out */
+            gamepad::gamepad_state state;
+            if (pad.take_changes(state) && pad.get_id() < network::agreed.pads)
             {
-                if (
-                    !netlib_write_uint8(network::buffer, pad.get_id()) ||
-                    !netlib_write_uint16(network::buffer, pad.get_state()->button_states) ||
-                    !netlib_write_float(network::buffer, pad.get_state()->stick_l_x) ||
-                    !netlib_write_float(network::buffer, pad.get_state()->stick_l_y) ||
-                    !netlib_write_float(network::buffer, pad.get_state()->stick_r_x) ||
-                    !netlib_write_float(network::buffer, pad.get_state()->stick_r_y) ||
-                    !netlib_write_uint8(network::buffer, pad.get_state()->trigger_l) ||
-                    !netlib_write_uint8(network::buffer, pad.get_state()->trigger_r))
-                    result = 0;
+                write_padstate(e, pad.get_id(), &state);
 
-                pad.m_changed = false;
+                /* Full, send it and continue in the next one */
+                if (!network::frame.add(e))
+                {
+                    result = network::send_frame();
+                    network::frame.begin(MSG_EVENT_FRAME, get_time_us());
+                    e.time = 0;
+                    result = network::frame.add(e) && result;
+                }
             }
         }
 
         if (!result)
-            printf("Writing event data to buffer failed: %s\n", netlib_get_error());
+            printf("Sending gamepad data failed: %s\n", netlib_get_error());
         
         return result;
     }
 
-    int write_keystate(netlib_byte_buf* buffer, uint16_t code, bool pressed)
+    void write_keystate(network::frame_event& e, uint16_t code, bool pressed)
     {
-		auto result = netlib_write_uint16(buffer, code);
-		if (!result)
-		{
-			printf("Couldn't write keycode: %s\n", netlib_get_error());
-			return -1;
-		}
-		
-	    result = netlib_write_uint8(buffer, pressed);
-        if (!result)
-        {
-			printf("Couldn't write keystate: %s\n", netlib_get_error());
-			return -1;
-        }
-		return 1;
+		e.kind = MSG_BUTTON_DATA;
+		e.code = code;
+		e.state = pressed;
     }
 
-    uint32_t get_ticks()
+    void write_padstate(network::frame_event& e, const uint8_t pad, const gamepad::gamepad_state* state)
     {
-#ifdef _WIN32
-		SYSTEMTIME time;
-		GetSystemTime(&time);
-		return (time.wSecond * 1000) + time.wMilliseconds;
-#else
-		struct timespec spec;
-		clock_gettime(CLOCK_MONOTONIC, &spec);
-		return round(spec.tv_nsec / 1.0e6);
-#endif
+        e.kind = MSG_GAMEPAD_DATA;
+        e.pad = pad;
+        e.buttons = state->button_states;
+        e.sticks[0] = network::quantize_axis(state->stick_l_x);
+        e.sticks[1] = network::quantize_axis(state->stick_l_y);
+        e.sticks[2] = network::quantize_axis(state->stick_r_x);
+        e.sticks[3] = network::quantize_axis(state->stick_r_y);
+        e.triggers[0] = uint8_t(state->trigger_l);
+        e.triggers[1] = uint8_t(state->trigger_r);
+    }
+
+    uint64_t get_time_us()
+    {
+		using namespace std::chrono;
+		return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
     }
 
     message recv_msg()
@@ -261,6 +223,8 @@ namespace util
 			return MSG_NAME_NOT_UNIQUE;
 		case MSG_SERVER_SHUTDOWN:
 			return MSG_SERVER_SHUTDOWN;
+		case MSG_TIME_SYNC:
+			return MSG_TIME_SYNC;
 		default:
 			printf("Received message with invalid id (%i).\n", msg_id);
 			return MSG_INVALID;
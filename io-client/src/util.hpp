@@ -12,7 +12,7 @@
 
 #include <netlib.h>
 #include <uiohook.h>
-#include "../../io-obs/network/messages.hpp"
+#include "../../io-obs/network/protocol.hpp"
 
 #ifdef _WIN32
 #define STICK_MAX_VAL       32767.f
@@ -22,8 +22,16 @@
 #define TRIGGER_MAX_VAL     256.f
 #endif
 
+/* Default of the --pad-rate option */
+#define PAD_RATE            60
+
 #define DEBUG_LOG(fmt, ...) printf("[%s:%d]: " fmt, __FUNCTION__, __LINE__, __VA_ARGS__);
 
+namespace gamepad
+{
+	class gamepad_state;
+}
+
 namespace util
 {
 	typedef struct
@@ -31,6 +39,10 @@ namespace util
 		bool monitor_gamepad;
 		bool monitor_mouse;
 		bool monitor_keyboard;
+		bool use_udp;
+		float deadzone_l, deadzone_r;	/* Radial stick deadzones, 0 - 1 */
+		float pad_epsilon;				/* Smaller changes of an axis or trigger aren't sent */
+		uint16_t pad_rate;				/* Analog pad updates sent per second, 0 for no limit */
 		char username[64];
 		uint16_t port;
 		ip_address ip;
@@ -41,20 +53,24 @@ namespace util
     /* Get config values and print help */
 	bool parse_arguments(int argc, char** args);
 
-	int send_text(char* buf);
+	/* False if the event isn't monitored */
+	bool to_frame_event(const uiohook_event* event, network::frame_event& e);
 
-	int write_uiohook_event(uiohook_event* const event);
+	/* Adds all changed gamepads to network::frame */
 
     int write_gamepad_data();
 
-	int write_keystate(netlib_byte_buf* buffer, uint16_t code, bool pressed);
+	void write_keystate(network::frame_event& e, uint16_t code, bool pressed);
+
+	void write_padstate(network::frame_event& e, uint8_t pad, const gamepad::gamepad_state* state);
 
 	inline uint16_t swap_be16(uint16_t in)
 	{
 	    return (in >> 8) | (in << 8);
 	}
 
-	uint32_t get_ticks();
+	/* Monotonic time in us, used for event timestamps */
+	uint64_t get_time_us();
     
 	message recv_msg();
 
@@ -0,0 +1,505 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+/**
+ * io-bench replays synthetic input through the same code the plugin
+ * runs inside OBS: hook::dispatch_proc -> event queue -> process_queue
+ * -> element_data_holder, then one overlay draw and one input history
+ * update per frame. libobs is replaced by obs_shim.cpp, so this runs
+ * anywhere, without a GPU or display.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <uiohook.h>
+#include "obs_shim.hpp"
+#include "../hook/hook_helper.hpp"
+#include "../hook/recording.hpp"
+#include "../sources/input_source.hpp"
+#include "../sources/key_bundle.hpp"
+#include "../util/overlay.hpp"
+#include "../util/element/element_data_holder.hpp"
+
+#define DEFAULT_FRAMES  20000
+#define FPS             60
+#define FRAME_NS        (1000000000ull / FPS)
+#define MOUSE_RATE      8000 /* Hz */
+#define PAD_RATE        1000 /* Packets per second for each pad */
+#define BENCH_PADS      4
+#define MAX_BURST       8    /* Stays below MAX_SIMULTANEOUS_KEYS */
+
+/* Every heap allocation is counted, the data path shouldn't have any */
+static uint64_t heap_allocs = 0;
+
+void* operator new(const size_t size)
+{
+    heap_allocs++;
+    if (const auto p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static uint64_t allocations()
+{
+    return heap_allocs + shim::bmem_allocs;
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static uint64_t elapsed_ns(const bench_clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now() - start).count();
+}
+
+/* Keys pressed during keyboard bursts */
+static const uint16_t burst_keys[] = {
+    VC_Q, VC_W, VC_E, VC_R, VC_T, VC_Y, VC_U, VC_I, VC_O, VC_P,
+    VC_A, VC_S, VC_D, VC_F, VC_G, VC_H, VC_J, VC_K, VC_L,
+    VC_Z, VC_X, VC_C, VC_V, VC_B, VC_N, VC_M,
+    VC_1, VC_2, VC_3, VC_4, VC_5, VC_6, VC_7, VC_8, VC_9, VC_0,
+    VC_SHIFT_L, VC_CONTROL_L, VC_ALT_L, VC_SPACE, VC_ENTER, VC_TAB,
+    VC_UP, VC_DOWN, VC_LEFT, VC_RIGHT
+};
+
+#define BURST_KEY_COUNT (sizeof(burst_keys) / sizeof(burst_keys[0]))
+
+/* One ccl layout entry, see presets/ for the format */
+class layout_writer
+{
+public:
+    explicit layout_writer(std::ofstream& out) : m_out(out) { }
+
+    void add(const std::string& id, const element_type type, const int x, const int y,
+        const int code = 0)
+    {
+        if (m_last.empty())
+            m_out << "1_" << CFG_FIRST_ID << "=" << id << "\n";
+        else
+            m_out << "1_" << m_last << CFG_NEXT_ID << "=" << id << "\n";
+
+        m_out << "0_" << id << CFG_TYPE << "=" << type << "\n";
+        m_out << "4_" << id << CFG_POS << "=" << x << "," << y << "\n";
+        m_out << "5_" << id << CFG_MAPPING << "=" << x << "," << y << ",64,64\n";
+        m_out << "0_" << id << CFG_KEY_CODE << "=" << code << "\n";
+        m_out << "0_" << id << CFG_Z_LEVEL << "=1\n";
+        m_last = id;
+    }
+
+    void add_property(const char prefix, const std::string& key, const int value) const
+    {
+        m_out << prefix << "_" << m_last << key << "=" << value << "\n";
+    }
+
+private:
+    std::ofstream& m_out;
+    std::string m_last;
+};
+
+/* Keyboard, mouse and gamepad elements, similar to the presets combined */
+static bool write_layout(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out.good())
+        return false;
+
+    out << "0_" << CFG_TOTAL_WIDTH << "=1920\n";
+    out << "0_" << CFG_TOTAL_HEIGHT << "=1080\n";
+    out << "0_" << CFG_FLAGS << "=" << (FLAG_GAMEPAD | FLAG_LEFT_STICK | FLAG_RIGHT_STICK) << "\n";
+
+    layout_writer layout(out);
+    layout.add("background", TEXTURE, 0, 0);
+
+    for (size_t i = 0; i < BURST_KEY_COUNT; i++)
+        layout.add("key_" + std::to_string(i), BUTTON, int(i % 16) * 66, int(i / 16) * 66,
+            burst_keys[i]);
+
+    layout.add("lmb", BUTTON, 1100, 0, VC_MOUSE_BUTTON1);
+    layout.add("rmb", BUTTON, 1166, 0, VC_MOUSE_BUTTON2);
+    layout.add("wheel", MOUSE_SCROLLWHEEL, 1232, 0);
+
+    for (auto i = 0; i < PAD_BUTTON_COUNT; i++)
+        layout.add("pad_" + std::to_string(i), BUTTON, (i % 8) * 66, 300 + (i / 8) * 66,
+            PAD_TO_VC(i));
+
+    layout.add("left_stick", ANALOG_STICK, 600, 300);
+    layout.add_property('0', CFG_SIDE, SIDE_LEFT);
+    layout.add_property('0', CFG_STICK_RADIUS, 32);
+    layout.add("right_stick", ANALOG_STICK, 700, 300);
+    layout.add_property('0', CFG_SIDE, SIDE_RIGHT);
+    layout.add_property('0', CFG_STICK_RADIUS, 32);
+    layout.add("left_trigger", TRIGGER, 800, 300);
+    layout.add_property('2', CFG_TRIGGER_MODE, 0);
+    layout.add_property('0', CFG_SIDE, SIDE_LEFT);
+    layout.add_property('0', CFG_DIRECTION, TRIGGER_UP);
+    layout.add("right_trigger", TRIGGER, 900, 300);
+    layout.add_property('2', CFG_TRIGGER_MODE, 0);
+    layout.add_property('0', CFG_SIDE, SIDE_RIGHT);
+    layout.add_property('0', CFG_DIRECTION, TRIGGER_UP);
+    layout.add("dpad", DPAD_STICK, 1000, 300);
+    layout.add("gamepad_id", GAMEPAD_ID, 1100, 300);
+    return out.good();
+}
+
+/* Event sources, each call produces one frame worth of input */
+enum scenario_type
+{
+    SCENARIO_KEYBOARD,
+    SCENARIO_MOUSE,
+    SCENARIO_GAMEPAD,
+    SCENARIO_REPLAY
+};
+
+struct scenario
+{
+    const char* name;
+    scenario_type type;
+};
+
+static const scenario scenarios[] = {
+    {"keyboard bursts", SCENARIO_KEYBOARD},
+    {"8 kHz mouse", SCENARIO_MOUSE},
+    {"4 pad flood", SCENARIO_GAMEPAD}
+};
+
+static const scenario replay_scenario = {"replay", SCENARIO_REPLAY};
+
+/* Loaded with -r, played back on a simulated clock */
+static recording::player replay;
+static bool replay_done = false;
+
+static void post(const uint16_t type, const uint16_t code = 0, const int16_t x = 0,
+    const int16_t y = 0)
+{
+    uiohook_event event = {};
+    event.type = static_cast<event_type>(type);
+
+    switch (type)
+    {
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+        event.data.keyboard.keycode = code;
+        break;
+    case EVENT_MOUSE_WHEEL:
+        event.data.wheel.rotation = x;
+        break;
+    default:
+        event.data.mouse.button = code;
+        event.data.mouse.x = x;
+        event.data.mouse.y = y;
+    }
+
+    hook::dispatch_proc(&event);
+}
+
+/* Returns the number of events produced */
+static uint64_t keyboard_frame(const uint32_t frame)
+{
+    /* Presses a burst of 1 to MAX_BURST keys, releases it the next frame */
+    const auto burst = frame / 2 % MAX_BURST + 1;
+    const auto first = frame / 2 * 7 % BURST_KEY_COUNT;
+    const uint16_t type = frame % 2 ? EVENT_KEY_RELEASED : EVENT_KEY_PRESSED;
+
+    for (uint32_t i = 0; i < burst; i++)
+        post(type, burst_keys[(first + i) % BURST_KEY_COUNT]);
+    return burst;
+}
+
+static uint64_t mouse_frame(const uint32_t frame)
+{
+    uint64_t count = 0;
+    for (auto i = 0; i < MOUSE_RATE / FPS; i++, count++)
+    {
+        const auto t = frame * (MOUSE_RATE / FPS) + i;
+        post(EVENT_MOUSE_MOVED, 0, int16_t(t % 1920), int16_t(t / 3 % 1080));
+    }
+
+    if (frame % 10 == 0)
+    {
+        post(frame % 20 ? EVENT_MOUSE_RELEASED : EVENT_MOUSE_PRESSED, MOUSE_BUTTON1);
+        post(EVENT_MOUSE_WHEEL, 0, frame % 40 ? 1 : -1);
+        count += 2;
+    }
+    return count;
+}
+
+/* Goes straight to the holder like the gamepad hook does */
+static uint64_t gamepad_frame(const uint32_t frame)
+{
+    uint64_t count = 0;
+    for (uint8_t pad = 0; pad < BENCH_PADS; pad++)
+    {
+        for (auto i = 0; i < PAD_RATE / FPS; i++, count++)
+        {
+            const auto t = frame * (PAD_RATE / FPS) + i;
+            const auto value = float(t % 200) / 100.f - 1.f;
+
+            switch (t % 4)
+            {
+            case 0:
+                hook::input_data->set_gamepad_axis(pad, static_cast<stick_data_type>(t / 4 % 4), value);
+                break;
+            case 1:
+                hook::input_data->set_gamepad_trigger(pad, t / 4 % 2 ? SIDE_LEFT : SIDE_RIGHT,
+                    (value + 1.f) / 2.f);
+                break;
+            case 2:
+                hook::input_data->set_gamepad_button(pad, PAD_TO_VC(t / 4 % PAD_BUTTON_COUNT),
+                    t / 8 % 2 ? STATE_PRESSED : STATE_RELEASED);
+                break;
+            default:
+                hook::input_data->set_gamepad_dpad(pad, static_cast<dpad_direction>(t / 4 % 4 + 1),
+                    t / 16 % 2 ? STATE_PRESSED : STATE_RELEASED);
+            }
+        }
+    }
+    return count;
+}
+
+static uint64_t replay_frame(const uint32_t frame)
+{
+    const auto applied = replay.applied();
+    replay_done = !replay.update((frame + 1) * FRAME_NS);
+    return replay.applied() - applied;
+}
+
+struct result
+{
+    uint32_t frames = 0;
+    uint64_t events = 0;
+    uint64_t ingest_ns = 0, draw_ns = 0, history_ns = 0;
+    uint64_t ingest_allocs = 0, draw_allocs = 0, history_allocs = 0;
+    uint64_t draw_calls = 0, vertices = 0;
+};
+
+static result run(const scenario& s, overlay* o, const uint32_t frames, const uint16_t masks)
+{
+    result r;
+    sources::key_bundle last_keys;
+    std::string history;
+    history.reserve(256);
+
+    /* An effect handle is only passed through */
+    static int effect_dummy;
+    const auto effect = reinterpret_cast<gs_effect_t*>(&effect_dummy);
+    shim::reset_counters();
+
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        /* Hook thread and tick callback */
+        auto allocs = allocations();
+        auto start = bench_clock::now();
+
+        switch (s.type)
+        {
+        case SCENARIO_KEYBOARD:
+            r.events += keyboard_frame(frame);
+            break;
+        case SCENARIO_MOUSE:
+            r.events += mouse_frame(frame);
+            break;
+        case SCENARIO_GAMEPAD:
+            r.events += gamepad_frame(frame);
+            break;
+        case SCENARIO_REPLAY:
+            r.events += replay_frame(frame);
+            break;
+        }
+        hook::process_queue(nullptr, 1.f / FPS);
+
+        r.ingest_ns += elapsed_ns(start);
+        r.ingest_allocs += allocations() - allocs;
+
+        /* input-overlay source render */
+        allocs = allocations();
+        start = bench_clock::now();
+        o->draw(effect, hook::input_data);
+        r.draw_ns += elapsed_ns(start);
+        r.draw_allocs += allocations() - allocs;
+
+        /* input-history source tick */
+        allocs = allocations();
+        start = bench_clock::now();
+        auto keys = sources::collect_keys(hook::input_data->snapshot(), masks);
+        if (!keys.m_empty && !keys.compare(&last_keys))
+        {
+            history = keys.to_string(uint8_t(masks), nullptr);
+            last_keys = keys;
+        }
+        r.history_ns += elapsed_ns(start);
+        r.history_allocs += allocations() - allocs;
+        r.frames++;
+
+        if (s.type == SCENARIO_REPLAY && replay_done)
+            break;
+    }
+
+    r.draw_calls = shim::draw_calls;
+    r.vertices = shim::vertices;
+    return r;
+}
+
+static void print_result(const scenario& s, const result& r)
+{
+    const auto events = r.events ? double(r.events) : 1.0;
+    const auto frames = r.frames ? r.frames : 1;
+
+    printf("%-16s %10llu %12.2f %10.3f %10.2f %10.3f %10.2f %10.3f %8.2f\n", s.name,
+        static_cast<unsigned long long>(r.events),
+        r.ingest_ns ? r.events * 1e3 / r.ingest_ns : 0.0, /* ns -> M/s */
+        r.ingest_allocs / events,
+        r.draw_ns / 1e3 / frames, r.draw_allocs / double(frames),
+        r.history_ns / 1e3 / frames, r.history_allocs / double(frames),
+        r.draw_calls / double(frames));
+}
+
+static void usage(const char* self)
+{
+    printf("Usage: %s [-f frames] [-l layout.ini] [-r recording [-s speed]] [-w recording] [-v]\n"
+           "  -f  Frames to simulate per scenario (%i fps), default %i\n"
+           "  -l  Layout config to draw, default is one generated next to io-bench\n"
+           "  -r  Replay an input recording instead of the synthetic input,\n"
+           "      until it ends or the frame limit is reached\n"
+           "  -s  Replay speed, default 1, 0 applies everything in one frame\n"
+           "  -w  Record the synthetic keyboard and mouse input\n"
+           "  -v  Show plugin log output\n", self, FPS, DEFAULT_FRAMES);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 0;
+    std::string layout, recording_file, output_file;
+    auto speed = 1.f;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc)
+        {
+            frames = uint32_t(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+        {
+            layout = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            recording_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            output_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            speed = float(atof(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-v"))
+        {
+            shim::verbose = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!frames)
+        frames = recording_file.empty() ? DEFAULT_FRAMES : UINT32_MAX;
+
+    if (!recording_file.empty())
+    {
+        if (!replay.load(recording_file))
+        {
+            printf("Couldn't load recording %s\n", recording_file.c_str());
+            return 1;
+        }
+        replay.start(0, speed);
+    }
+
+    if (layout.empty())
+    {
+        /* Next to the executable, so it ends up in the build directory
+         * instead of wherever the bench was started from */
+        const std::string self = argv[0];
+        const auto slash = self.find_last_of("/\\");
+        layout = (slash == std::string::npos ? "" : self.substr(0, slash + 1)) + "io-bench-layout.ini";
+        if (!write_layout(layout))
+        {
+            printf("Couldn't write %s\n", layout.c_str());
+            return 1;
+        }
+    }
+
+    hook::init_data_holder();
+
+    sources::shared_settings settings;
+    settings.layout_file = layout;
+    settings.image_file = "io-bench.png"; /* Never read, see gs_image_file_init */
+    overlay o(&settings);
+
+    if (!o.is_loaded())
+    {
+        printf("Couldn't load layout %s\n", layout.c_str());
+        return 1;
+    }
+
+    uint16_t masks = 0;
+    util_enable_mask(masks, MASK_INCLUDE_MOUSE);
+    util_enable_mask(masks, MASK_INCLUDE_PAD);
+
+    if (!output_file.empty() && !recording::start_recording(output_file))
+    {
+        printf("Couldn't record to %s\n", output_file.c_str());
+        return 1;
+    }
+
+    if (recording_file.empty())
+        printf("%u frames per scenario\n\n", frames);
+    printf("%-16s %10s %12s %10s %10s %10s %10s %10s %8s\n", "scenario", "events",
+        "Mevents/s", "alloc/ev", "draw us", "alloc/fr", "hist us", "alloc/fr", "draws");
+
+    if (recording_file.empty())
+    {
+        for (const auto& s : scenarios)
+            print_result(s, run(s, &o, frames, masks));
+    }
+    else
+    {
+        const auto r = run(replay_scenario, &o, frames, masks);
+        print_result(replay_scenario, r);
+        printf("\n%u frames replayed", r.frames);
+        if (replay.skipped())
+            printf(", %llu records from another platform were skipped",
+                static_cast<unsigned long long>(replay.skipped()));
+        printf("\n");
+    }
+
+    if (hook::event_queue.dropped())
+        printf("\n%zu events were dropped by the event queue\n", hook::event_queue.dropped());
+
+    recording::stop_recording();
+    o.unload();
+    delete hook::input_data;
+    hook::input_data = nullptr;
+    return 0;
+}
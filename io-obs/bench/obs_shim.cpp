@@ -0,0 +1,346 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+/**
+ * Stand-ins for the parts of libobs and libuiohook the data path uses.
+ * Nothing is rendered, graphics calls are only counted. Vertex buffers
+ * keep their data in memory, so the CPU side of the overlay does the
+ * same work it would do in OBS
+ */
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <obs-module.h>
+#include <graphics/image-file.h>
+#include <uiohook.h>
+#include "obs_shim.hpp"
+
+namespace shim
+{
+    uint64_t draw_calls = 0;
+    uint64_t vertices = 0;
+    uint64_t buffer_uploads = 0;
+    uint64_t bmem_allocs = 0;
+
+    uint32_t image_cx = 2048, image_cy = 2048;
+
+    bool verbose = false;
+
+    void reset_counters()
+    {
+        draw_calls = 0;
+        vertices = 0;
+        buffer_uploads = 0;
+        bmem_allocs = 0;
+    }
+}
+
+/* Every handle has to be a distinct, valid address */
+struct gs_texture
+{
+    int dummy;
+};
+
+struct gs_texture_render
+{
+    gs_texture tex;
+};
+
+struct gs_vertex_buffer
+{
+    gs_vb_data* data;
+};
+
+static gs_texture image_texture;
+
+/* libobs */
+
+void blog(const int log_level, const char* format, ...)
+{
+    if (log_level >= LOG_INFO && !shim::verbose)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+const char* obs_module_text(const char* lookup_string)
+{
+    return lookup_string;
+}
+
+void obs_enter_graphics()
+{
+}
+
+void obs_leave_graphics()
+{
+}
+
+void obs_add_tick_callback(void (*tick)(void*, float), void* param)
+{
+    UNUSED_PARAMETER(tick);
+    UNUSED_PARAMETER(param);
+}
+
+void obs_remove_tick_callback(void (*tick)(void*, float), void* param)
+{
+    UNUSED_PARAMETER(tick);
+    UNUSED_PARAMETER(param);
+}
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings)
+{
+    UNUSED_PARAMETER(source);
+    UNUSED_PARAMETER(settings);
+}
+
+const char* obs_source_get_name(const obs_source_t* source)
+{
+    UNUSED_PARAMETER(source);
+    return "io-bench";
+}
+
+uint64_t os_gettime_ns()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void* bmalloc(const size_t size)
+{
+    shim::bmem_allocs++;
+    return malloc(size ? size : 1);
+}
+
+void* bzalloc(const size_t size)
+{
+    shim::bmem_allocs++;
+    return calloc(1, size ? size : 1);
+}
+
+void bfree(void* ptr)
+{
+    free(ptr);
+}
+
+/* Graphics */
+
+gs_vb_data* gs_vbdata_create()
+{
+    return static_cast<gs_vb_data*>(bzalloc(sizeof(gs_vb_data)));
+}
+
+void gs_vbdata_destroy(gs_vb_data* data)
+{
+    if (!data)
+        return;
+
+    for (size_t i = 0; i < data->num_tex; i++)
+        bfree(data->tvarray[i].array);
+    bfree(data->tvarray);
+    bfree(data->points);
+    bfree(data->normals);
+    bfree(data->tangents);
+    bfree(data->colors);
+    bfree(data);
+}
+
+gs_vertbuffer_t* gs_vertexbuffer_create(gs_vb_data* data, const uint32_t flags)
+{
+    UNUSED_PARAMETER(flags);
+    return new gs_vertex_buffer{data};
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t* vertbuffer)
+{
+    if (!vertbuffer)
+        return;
+    gs_vbdata_destroy(vertbuffer->data);
+    delete vertbuffer;
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t* vertbuffer)
+{
+    UNUSED_PARAMETER(vertbuffer);
+    shim::buffer_uploads++;
+}
+
+gs_vb_data* gs_vertexbuffer_get_data(const gs_vertbuffer_t* vertbuffer)
+{
+    return vertbuffer ? vertbuffer->data : nullptr;
+}
+
+void gs_load_vertexbuffer(gs_vertbuffer_t* vertbuffer)
+{
+    UNUSED_PARAMETER(vertbuffer);
+}
+
+void gs_load_indexbuffer(gs_indexbuffer_t* indexbuffer)
+{
+    UNUSED_PARAMETER(indexbuffer);
+}
+
+void gs_draw(const gs_draw_mode draw_mode, const uint32_t start_vert, const uint32_t num_verts)
+{
+    UNUSED_PARAMETER(draw_mode);
+    UNUSED_PARAMETER(start_vert);
+    shim::draw_calls++;
+    shim::vertices += num_verts;
+}
+
+void gs_draw_sprite(gs_texture_t* tex, const uint32_t flip, const uint32_t width, const uint32_t height)
+{
+    UNUSED_PARAMETER(tex);
+    UNUSED_PARAMETER(flip);
+    UNUSED_PARAMETER(width);
+    UNUSED_PARAMETER(height);
+    shim::draw_calls++;
+    shim::vertices += 4;
+}
+
+void gs_clear(const uint32_t clear_flags, const vec4* color, const float depth, const uint8_t stencil)
+{
+    UNUSED_PARAMETER(clear_flags);
+    UNUSED_PARAMETER(color);
+    UNUSED_PARAMETER(depth);
+    UNUSED_PARAMETER(stencil);
+}
+
+void gs_ortho(const float left, const float right, const float top, const float bottom,
+    const float znear, const float zfar)
+{
+    UNUSED_PARAMETER(left);
+    UNUSED_PARAMETER(right);
+    UNUSED_PARAMETER(top);
+    UNUSED_PARAMETER(bottom);
+    UNUSED_PARAMETER(znear);
+    UNUSED_PARAMETER(zfar);
+}
+
+void gs_blend_state_push()
+{
+}
+
+void gs_blend_state_pop()
+{
+}
+
+void gs_blend_function(const gs_blend_type src, const gs_blend_type dest)
+{
+    UNUSED_PARAMETER(src);
+    UNUSED_PARAMETER(dest);
+}
+
+void gs_blend_function_separate(const gs_blend_type src_c, const gs_blend_type dest_c,
+    const gs_blend_type src_a, const gs_blend_type dest_a)
+{
+    UNUSED_PARAMETER(src_c);
+    UNUSED_PARAMETER(dest_c);
+    UNUSED_PARAMETER(src_a);
+    UNUSED_PARAMETER(dest_a);
+}
+
+gs_eparam_t* gs_effect_get_param_by_name(const gs_effect_t* effect, const char* name)
+{
+    UNUSED_PARAMETER(effect);
+    UNUSED_PARAMETER(name);
+    return nullptr;
+}
+
+void gs_effect_set_texture(gs_eparam_t* param, gs_texture_t* val)
+{
+    UNUSED_PARAMETER(param);
+    UNUSED_PARAMETER(val);
+}
+
+gs_texrender_t* gs_texrender_create(const gs_color_format format, const gs_zstencil_format zsformat)
+{
+    UNUSED_PARAMETER(format);
+    UNUSED_PARAMETER(zsformat);
+    return new gs_texture_render();
+}
+
+void gs_texrender_destroy(gs_texrender_t* texrender)
+{
+    delete texrender;
+}
+
+bool gs_texrender_begin(gs_texrender_t* texrender, const uint32_t cx, const uint32_t cy)
+{
+    return texrender && cx && cy;
+}
+
+void gs_texrender_end(gs_texrender_t* texrender)
+{
+    UNUSED_PARAMETER(texrender);
+}
+
+void gs_texrender_reset(gs_texrender_t* texrender)
+{
+    UNUSED_PARAMETER(texrender);
+}
+
+gs_texture_t* gs_texrender_get_texture(const gs_texrender_t* texrender)
+{
+    return texrender ? const_cast<gs_texture_t*>(&texrender->tex) : nullptr;
+}
+
+/* No file is read, every image has the same size */
+void gs_image_file_init(gs_image_file_t* image, const char* file)
+{
+    if (!image)
+        return;
+
+    *image = {};
+    image->loaded = file && *file;
+    if (image->loaded)
+    {
+        image->format = GS_RGBA;
+        image->cx = shim::image_cx;
+        image->cy = shim::image_cy;
+    }
+}
+
+void gs_image_file_free(gs_image_file_t* image)
+{
+    if (image)
+        *image = {};
+}
+
+void gs_image_file_init_texture(gs_image_file_t* image)
+{
+    if (image && image->loaded)
+        image->texture = &image_texture;
+}
+
+/* libuiohook, the hook itself is never started */
+
+void hook_set_logger_proc(logger_t logger_proc)
+{
+    UNUSED_PARAMETER(logger_proc);
+}
+
+void hook_set_dispatch_proc(dispatcher_t dispatch_proc)
+{
+    UNUSED_PARAMETER(dispatch_proc);
+}
+
+int hook_run()
+{
+    return UIOHOOK_SUCCESS;
+}
+
+int hook_stop()
+{
+    return UIOHOOK_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/* Counters kept by the libobs stand-ins, so io-bench
+ * can see what the plugin would have sent to the GPU */
+namespace shim
+{
+    extern uint64_t draw_calls;
+    extern uint64_t vertices;
+    extern uint64_t buffer_uploads;
+    extern uint64_t bmem_allocs;
+
+    /* Size every gs_image_file gets "loaded" with */
+    extern uint32_t image_cx, image_cy;
+
+    /* Forward LOG_INFO messages, warnings and errors are always shown */
+    extern bool verbose;
+
+    void reset_counters();
+}
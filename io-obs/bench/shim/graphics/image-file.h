@@ -0,0 +1,32 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "graphics.h"
+
+struct gs_image_file
+{
+    gs_texture_t* texture;
+    enum gs_color_format format;
+    uint32_t cx, cy;
+    bool loaded;
+};
+
+typedef struct gs_image_file gs_image_file_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gs_image_file_init(gs_image_file_t* image, const char* file);
+void gs_image_file_free(gs_image_file_t* image);
+void gs_image_file_init_texture(gs_image_file_t* image);
+
+#ifdef __cplusplus
+}
+#endif
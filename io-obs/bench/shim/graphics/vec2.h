@@ -0,0 +1,19 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+struct vec2
+{
+    float x, y;
+};
+
+static inline void vec2_set(struct vec2* dst, float x, float y)
+{
+    dst->x = x;
+    dst->y = y;
+}
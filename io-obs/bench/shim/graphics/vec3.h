@@ -0,0 +1,22 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+/* Same size as the SSE version in libobs */
+struct vec3
+{
+    float x, y, z, w;
+};
+
+static inline void vec3_set(struct vec3* dst, float x, float y, float z)
+{
+    dst->x = x;
+    dst->y = y;
+    dst->z = z;
+    dst->w = 0.f;
+}
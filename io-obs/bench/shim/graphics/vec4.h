@@ -0,0 +1,18 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+struct vec4
+{
+    float x, y, z, w;
+};
+
+static inline void vec4_zero(struct vec4* v)
+{
+    v->x = v->y = v->z = v->w = 0.f;
+}
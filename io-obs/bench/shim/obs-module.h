@@ -0,0 +1,50 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+/* Just enough of libobs for io-bench, see obs_shim.cpp */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* libobs includes it too, util.cpp relies on it */
+#include "graphics/graphics.h"
+#include "util/platform.h"
+#include "util/bmem.h"
+
+#define LOG_ERROR   100
+#define LOG_WARNING 200
+#define LOG_INFO    300
+#define LOG_DEBUG   400
+
+#define UNUSED_PARAMETER(param) (void)param
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+
+void blog(int log_level, const char* format, ...);
+
+const char* obs_module_text(const char* lookup_string);
+
+void obs_enter_graphics(void);
+void obs_leave_graphics(void);
+
+void obs_add_tick_callback(void (*tick)(void* param, float seconds), void* param);
+void obs_remove_tick_callback(void (*tick)(void* param, float seconds), void* param);
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings);
+const char* obs_source_get_name(const obs_source_t* source);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* bmalloc(size_t size);
+void* bzalloc(size_t size);
+void bfree(void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
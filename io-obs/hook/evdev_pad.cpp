@@ -0,0 +1,385 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "evdev_pad.hpp"
+
+#ifdef LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+/* Events taken from the kernel per read */
+#define READ_EVENTS 64
+
+#define BIT_SET(bits, n) ((bits)[(n) / 8] & (1 << ((n) % 8)))
+
+namespace evdev
+{
+    /* Names as the kernel's gamepad documentation uses them,
+     * xpad and most HID drivers report X and Y as BTN_X and BTN_Y */
+    static const button_map gamepad_buttons[] = {
+        {BTN_SOUTH, PAD_BIT_A},
+        {BTN_EAST, PAD_BIT_B},
+        {BTN_X, PAD_BIT_X},
+        {BTN_Y, PAD_BIT_Y},
+        {BTN_TL, PAD_BIT_LB},
+        {BTN_TR, PAD_BIT_RB},
+        {BTN_TL2, BUTTON_LEFT_TRIGGER},
+        {BTN_TR2, BUTTON_RIGHT_TRIGGER},
+        {BTN_SELECT, PAD_BIT_BACK},
+        {BTN_START, PAD_BIT_START},
+        {BTN_MODE, PAD_BIT_GUIDE},
+        {BTN_THUMBL, PAD_BIT_L_ANALOG},
+        {BTN_THUMBR, PAD_BIT_R_ANALOG},
+        {BTN_DPAD_UP, PAD_BIT_DPAD_UP},
+        {BTN_DPAD_DOWN, PAD_BIT_DPAD_DOWN},
+        {BTN_DPAD_LEFT, PAD_BIT_DPAD_LEFT},
+        {BTN_DPAD_RIGHT, PAD_BIT_DPAD_RIGHT},
+        /* xpad's dpad on pads that map it to buttons */
+        {BTN_TRIGGER_HAPPY1, PAD_BIT_DPAD_LEFT},
+        {BTN_TRIGGER_HAPPY2, PAD_BIT_DPAD_RIGHT},
+        {BTN_TRIGGER_HAPPY3, PAD_BIT_DPAD_UP},
+        {BTN_TRIGGER_HAPPY4, PAD_BIT_DPAD_DOWN}
+    };
+
+    /* Fight sticks and flight sticks only number their keys (BTN_TRIGGER,
+     * BTN_THUMB, ...), they're handed out in this order */
+    static const uint32_t generic_buttons[] = {
+        PAD_BIT_A, PAD_BIT_B, PAD_BIT_X, PAD_BIT_Y, PAD_BIT_LB, PAD_BIT_RB,
+        BUTTON_LEFT_TRIGGER, BUTTON_RIGHT_TRIGGER, PAD_BIT_BACK, PAD_BIT_START,
+        PAD_BIT_L_ANALOG, PAD_BIT_R_ANALOG, PAD_BIT_GUIDE
+    };
+
+    static void set_bit(uint16_t& bits, const uint16_t bit, const bool set)
+    {
+        if (set)
+            bits |= bit;
+        else
+            bits &= ~bit;
+    }
+
+    static bool same(const recording::xinput_sample& a, const recording::xinput_sample& b)
+    {
+        return a.buttons == b.buttons && a.left_trigger == b.left_trigger
+            && a.right_trigger == b.right_trigger && a.left_x == b.left_x
+            && a.left_y == b.left_y && a.right_x == b.right_x && a.right_y == b.right_y;
+    }
+
+    device::~device()
+    {
+        close();
+    }
+
+    bool device::open(const std::string& path)
+    {
+        close();
+        m_fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_fd == -1)
+            return false;
+
+        uint8_t keys[KEY_MAX / 8 + 1] = {};
+        uint8_t abs[ABS_MAX / 8 + 1] = {};
+        if (ioctl(m_fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) == -1 ||
+            ioctl(m_fd, EVIOCGBIT(EV_ABS, sizeof(abs)), abs) == -1)
+        {
+            close();
+            return false;
+        }
+
+        /* Keyboards, mice and motion sensors are event devices too,
+         * but only joysticks have keys in the joystick ranges */
+        map_buttons(keys);
+        if (m_buttons.empty())
+        {
+            close();
+            return false;
+        }
+
+        for (uint16_t code = 0; code < ABS_CNT; code++)
+        {
+            if (!BIT_SET(abs, code) || ioctl(m_fd, EVIOCGABS(code), &m_axes[code]) == -1)
+                m_axes[code] = {};
+        }
+        map_axes(abs);
+
+        m_path = path;
+        resync();
+        m_state = m_report;
+        return true;
+    }
+
+    void device::close()
+    {
+        if (m_fd != -1)
+            ::close(m_fd);
+        m_fd = -1;
+        m_path.clear();
+        m_report = {};
+        m_state = {};
+        m_dropped = false;
+        m_buttons.clear();
+    }
+
+    void device::map_buttons(const uint8_t* keys)
+    {
+        m_buttons.clear();
+
+        if (BIT_SET(keys, BTN_GAMEPAD))
+        {
+            for (const auto& b : gamepad_buttons)
+            {
+                if (BIT_SET(keys, b.code))
+                    m_buttons.emplace_back(b);
+            }
+            return;
+        }
+
+        const auto count = sizeof(generic_buttons) / sizeof(*generic_buttons);
+        size_t next = 0;
+        const auto add = [&](const uint16_t first, const uint16_t last)
+        {
+            for (auto code = first; code <= last && next < count; code++)
+            {
+                if (BIT_SET(keys, code))
+                    m_buttons.push_back({code, generic_buttons[next++]});
+            }
+        };
+
+        add(BTN_JOYSTICK, BTN_DIGI - 1);
+        add(BTN_TRIGGER_HAPPY, BTN_TRIGGER_HAPPY40);
+    }
+
+    void device::map_axes(const uint8_t* abs)
+    {
+        const auto assign = [&](const uint16_t code, const axis_role role)
+        {
+            if (!BIT_SET(abs, code) || !has_axis(code) || m_roles[code] != AXIS_NONE)
+                return false;
+            m_roles[code] = role;
+            return true;
+        };
+
+        for (auto& role : m_roles)
+            role = AXIS_NONE;
+
+        assign(ABS_X, AXIS_LEFT_X);
+        assign(ABS_Y, AXIS_LEFT_Y);
+        assign(ABS_HAT0X, AXIS_HAT_X);
+        assign(ABS_HAT0Y, AXIS_HAT_Y);
+
+        /* xpad and most console pads put the right stick on RX/RY and
+         * the triggers on Z/RZ, plain HID pads use Z/RZ for the stick */
+        if (has_axis(ABS_RX) && has_axis(ABS_RY))
+        {
+            assign(ABS_RX, AXIS_RIGHT_X);
+            assign(ABS_RY, AXIS_RIGHT_Y);
+            assign(ABS_Z, AXIS_LEFT_TRIGGER);
+            assign(ABS_RZ, AXIS_RIGHT_TRIGGER);
+        }
+        else if (has_axis(ABS_Z) && has_axis(ABS_RZ))
+        {
+            assign(ABS_Z, AXIS_RIGHT_X);
+            assign(ABS_RZ, AXIS_RIGHT_Y);
+        }
+
+        if (!has_role(AXIS_LEFT_TRIGGER))
+            assign(ABS_BRAKE, AXIS_LEFT_TRIGGER) || assign(ABS_THROTTLE, AXIS_LEFT_TRIGGER);
+        if (!has_role(AXIS_RIGHT_TRIGGER))
+            assign(ABS_GAS, AXIS_RIGHT_TRIGGER);
+
+        /* Flight sticks twist their stick or have rudder pedals */
+        if (!has_role(AXIS_RIGHT_X))
+            assign(ABS_RZ, AXIS_RIGHT_X) || assign(ABS_RUDDER, AXIS_RIGHT_X);
+    }
+
+    bool device::read(bool& changed)
+    {
+        input_event events[READ_EVENTS];
+
+        /* Level triggered, but everything is read now so
+         * a burst of events ends up in one update */
+        for (;;)
+        {
+            const auto result = ::read(m_fd, events, sizeof(events));
+            if (result == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                /* ENODEV once the pad was unplugged */
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if (result == 0)
+                return false;
+
+            const auto count = size_t(result) / sizeof(input_event);
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto& e = events[i];
+                if (e.type != EV_SYN)
+                {
+                    if (!m_dropped)
+                        apply(e);
+                    continue;
+                }
+
+                if (e.code == SYN_DROPPED)
+                {
+                    /* The kernel's buffer overflowed, what follows
+                     * until the next report can't be trusted */
+                    m_dropped = true;
+                }
+                else if (e.code == SYN_REPORT)
+                {
+                    if (m_dropped)
+                    {
+                        resync();
+                        m_dropped = false;
+                    }
+
+                    if (!same(m_report, m_state))
+                    {
+                        m_state = m_report;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void device::apply(const input_event& e)
+    {
+        if (e.type == EV_KEY)
+        {
+            for (const auto& b : m_buttons)
+            {
+                if (b.code != e.code)
+                    continue;
+
+                /* Only used by pads without analog triggers, others send both */
+                if (b.bit == BUTTON_LEFT_TRIGGER)
+                {
+                    if (!has_role(AXIS_LEFT_TRIGGER))
+                        m_report.left_trigger = e.value ? uint8_t(SAMPLE_TRIGGER_MAX) : 0;
+                }
+                else if (b.bit == BUTTON_RIGHT_TRIGGER)
+                {
+                    if (!has_role(AXIS_RIGHT_TRIGGER))
+                        m_report.right_trigger = e.value ? uint8_t(SAMPLE_TRIGGER_MAX) : 0;
+                }
+                else
+                {
+                    set_bit(m_report.buttons, uint16_t(b.bit), e.value != 0);
+                }
+                return;
+            }
+            return;
+        }
+
+        if (e.type != EV_ABS || e.code >= ABS_CNT)
+            return;
+
+        /* Sticks point down on evdev and up in xinput */
+        switch (m_roles[e.code])
+        {
+        case AXIS_LEFT_X:
+            m_report.left_x = stick_value(e.code, e.value);
+            break;
+        case AXIS_LEFT_Y:
+            m_report.left_y = int16_t(-stick_value(e.code, e.value));
+            break;
+        case AXIS_RIGHT_X:
+            m_report.right_x = stick_value(e.code, e.value);
+            break;
+        case AXIS_RIGHT_Y:
+            m_report.right_y = int16_t(-stick_value(e.code, e.value));
+            break;
+        case AXIS_LEFT_TRIGGER:
+            m_report.left_trigger = trigger_value(e.code, e.value);
+            break;
+        case AXIS_RIGHT_TRIGGER:
+            m_report.right_trigger = trigger_value(e.code, e.value);
+            break;
+        case AXIS_HAT_X:
+            set_bit(m_report.buttons, PAD_BIT_DPAD_LEFT, e.value < 0);
+            set_bit(m_report.buttons, PAD_BIT_DPAD_RIGHT, e.value > 0);
+            break;
+        case AXIS_HAT_Y:
+            set_bit(m_report.buttons, PAD_BIT_DPAD_UP, e.value < 0);
+            set_bit(m_report.buttons, PAD_BIT_DPAD_DOWN, e.value > 0);
+            break;
+        default: ;
+        }
+    }
+
+    void device::resync()
+    {
+        uint8_t keys[KEY_MAX / 8 + 1] = {};
+        input_event e = {};
+
+        m_report = {};
+        if (ioctl(m_fd, EVIOCGKEY(sizeof(keys)), keys) != -1)
+        {
+            e.type = EV_KEY;
+            for (const auto& b : m_buttons)
+            {
+                e.code = b.code;
+                e.value = BIT_SET(keys, b.code) ? 1 : 0;
+                apply(e);
+            }
+        }
+
+        e.type = EV_ABS;
+        for (uint16_t code = 0; code < ABS_CNT; code++)
+        {
+            input_absinfo info = {};
+            if (m_roles[code] == AXIS_NONE || ioctl(m_fd, EVIOCGABS(code), &info) == -1)
+                continue;
+            e.code = code;
+            e.value = info.value;
+            apply(e);
+        }
+    }
+
+    bool device::has_axis(const uint16_t code) const
+    {
+        return m_axes[code].maximum != m_axes[code].minimum;
+    }
+
+    bool device::has_role(const axis_role role) const
+    {
+        for (const auto r : m_roles)
+        {
+            if (r == role)
+                return true;
+        }
+        return false;
+    }
+
+    int16_t device::stick_value(const uint16_t code, const int32_t value) const
+    {
+        const auto& info = m_axes[code];
+        const auto range = float(info.maximum) - float(info.minimum);
+        if (range <= 0.f)
+            return 0;
+
+        const auto v = UTIL_CLAMP(-1.f, 2.f * (value - info.minimum) / range - 1.f, 1.f);
+        return int16_t(v * SAMPLE_STICK_MAX);
+    }
+
+    uint8_t device::trigger_value(const uint16_t code, const int32_t value) const
+    {
+        const auto& info = m_axes[code];
+        const auto range = float(info.maximum) - float(info.minimum);
+        if (range <= 0.f)
+            return 0;
+
+        const auto v = UTIL_CLAMP(0.f, (value - info.minimum) / range, 1.f);
+        return uint8_t(v * SAMPLE_TRIGGER_MAX);
+    }
+}
+#endif /* LINUX */
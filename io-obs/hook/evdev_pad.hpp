@@ -0,0 +1,101 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include "../util/util.hpp"
+
+#ifdef LINUX
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <linux/input.h>
+#include "recording.hpp"
+
+/* Sample values for a fully deflected stick and a fully pressed trigger */
+#define SAMPLE_STICK_MAX    32767.f
+#define SAMPLE_TRIGGER_MAX  255.f
+
+/* Keys that are shown as a trigger, above the xinput button bits */
+#define BUTTON_LEFT_TRIGGER     0x10000
+#define BUTTON_RIGHT_TRIGGER    0x20000
+
+namespace evdev
+{
+    /* What an axis of a device is used for */
+    enum axis_role : uint8_t
+    {
+        AXIS_NONE,
+        AXIS_LEFT_X,
+        AXIS_LEFT_Y,
+        AXIS_RIGHT_X,
+        AXIS_RIGHT_Y,
+        AXIS_LEFT_TRIGGER,
+        AXIS_RIGHT_TRIGGER,
+        AXIS_HAT_X,
+        AXIS_HAT_Y
+    };
+
+    /* Key code of a device and the xinput button it's shown as */
+    struct button_map
+    {
+        uint16_t code;
+        uint32_t bit;   /* PAD_BIT_* or BUTTON_*_TRIGGER */
+    };
+
+    /**
+     * One gamepad, fight stick or flight stick behind /dev/input/eventN.
+     * It's opened non-blocking, so all pads can be read from one epoll
+     * loop. Events are collected until the kernel ends a report with
+     * SYN_REPORT, so the state never holds half of one. The state is kept
+     * in xinput's terms, which is what remote pads use and what recordings
+     * store for Windows pads. Which axis and key ends up where is decided
+     * per device from the axes and keys it reports.
+     */
+    class device
+    {
+    public:
+        ~device();
+
+        /* False if path can't be opened or isn't a gamepad */
+        bool open(const std::string& path);
+        void close();
+
+        bool valid() const { return m_fd != -1; }
+        int fd() const { return m_fd; }
+        const std::string& path() const { return m_path; }
+
+        /* Reads everything that's pending. changed is set if a complete
+         * report changed the state. False if the device is gone */
+        bool read(bool& changed);
+
+        const recording::xinput_sample& state() const { return m_state; }
+    private:
+        /* Fills the axis and button maps from the device's capabilities */
+        void map_axes(const uint8_t* abs);
+        void map_buttons(const uint8_t* keys);
+
+        void apply(const input_event& e);
+        /* Asks the kernel for the whole state, after it dropped events */
+        void resync();
+        /* False if the pad doesn't report this axis */
+        bool has_axis(uint16_t code) const;
+        bool has_role(axis_role role) const;
+        int16_t stick_value(uint16_t code, int32_t value) const;
+        uint8_t trigger_value(uint16_t code, int32_t value) const;
+
+        int m_fd = -1;
+        std::string m_path;
+        input_absinfo m_axes[ABS_CNT] = {};
+        axis_role m_roles[ABS_CNT] = {};
+        std::vector<button_map> m_buttons;
+        recording::xinput_sample m_report = {}; /* Collects events until SYN_REPORT */
+        recording::xinput_sample m_state = {};
+        bool m_dropped = false; /* Events up to the next SYN_REPORT are incomplete */
+    };
+}
+#endif /* LINUX */
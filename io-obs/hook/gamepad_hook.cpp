@@ -8,23 +8,65 @@
 #include <util/platform.h>
 #include "gamepad_hook.hpp"
 #include "hook_helper.hpp"
+#include "recording.hpp"
 
 #include "../util/element/element_data_holder.hpp"
-#include "../util/element/element_button.hpp"
-#include "../util/element/element_analog_stick.hpp"
-#include "../util/element/element_trigger.hpp"
-#include "../util/element/element_dpad.hpp"
+
+#ifdef LINUX
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <vector>
+
+#define EVDEV_DIR   "/dev/input"
+/* epoll user data of the wake up event and the hotplug
+ * watch, pads use their id */
+#define WAKE_ID     0xff
+#define NOTIFY_ID   0xfe
+static_assert(HOOK_PAD_COUNT < NOTIFY_ID, "pad ids would collide with NOTIFY_ID");
+/* Room for a few inotify events with names */
+#define NOTIFY_BUFFER_SIZE  (16 * (sizeof(inotify_event) + NAME_MAX + 1))
+#endif
 
 namespace gamepad
 {
     bool gamepad_hook_state = false;
     bool gamepad_hook_run_flag = true;
-    GamepadState pad_states[PAD_COUNT];
+    GamepadState pad_states[HOOK_PAD_COUNT];
 
 #ifdef _WIN32
     static HANDLE hook_thread;
 #else
     static pthread_t game_pad_hook_thread;
+    static int epoll_fd = -1;
+    static int wake_fd = -1;    /* eventfd, wakes the thread up to exit or rescan */
+    static int notify_fd = -1;  /* inotify on EVDEV_DIR, for pads that come and go */
+    static std::atomic<bool> rescan{false};
+
+    static void wake()
+    {
+        const uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) != sizeof(one))
+            blog(LOG_WARNING, "[input-overlay] Couldn't wake gamepad thread: %s", strerror(errno));
+    }
+
+    static void close_fds()
+    {
+        if (epoll_fd != -1)
+            close(epoll_fd);
+        if (wake_fd != -1)
+            close(wake_fd);
+        if (notify_fd != -1)
+            close(notify_fd);
+        epoll_fd = wake_fd = notify_fd = -1;
+    }
 #endif
 
     void start_pad_hook()
@@ -40,20 +82,50 @@ namespace gamepad
             blog(LOG_INFO, "[input-overlay] Gamepad hook init failed");
             return;
         }
-#endif
-        gamepad_hook_state = gamepad_hook_run_flag = init_pad_devices();
 
-#ifdef _WIN32
+        gamepad_hook_state = gamepad_hook_run_flag = init_pad_devices();
         hook_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(hook_method),
             nullptr, 0, nullptr);
         gamepad_hook_state = hook_thread;
 #else
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = WAKE_ID;
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd == -1 || wake_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) == -1)
+        {
+            blog(LOG_ERROR, "[input-overlay] Gamepad hook init failed: %s", strerror(errno));
+            close_fds();
+            return;
+        }
+
+        /* Without it pads still work, they just have to be reloaded by hand */
+        notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        ev.data.u32 = NOTIFY_ID;
+        if (notify_fd == -1 || inotify_add_watch(notify_fd, EVDEV_DIR, IN_CREATE | IN_ATTRIB | IN_DELETE) == -1
+            || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, notify_fd, &ev) == -1)
+        {
+            blog(LOG_WARNING, "[input-overlay] Gamepad hotplug unavailable: %s", strerror(errno));
+            if (notify_fd != -1)
+                close(notify_fd);
+            notify_fd = -1;
+        }
+
+        /* The thread looks for pads first thing, it keeps running
+         * without any so pads can be added later on */
+        rescan = true;
+        gamepad_hook_run_flag = true;
         gamepad_hook_state = pthread_create(&game_pad_hook_thread, nullptr, hook_method, nullptr) == 0;
+        if (!gamepad_hook_state)
+            close_fds();
 #endif
     }
 
     bool init_pad_devices()
     {
+#ifdef _WIN32
         uint8_t id = 0;
         auto flag = false;
         for (auto& state : pad_states)
@@ -63,6 +135,13 @@ namespace gamepad
                 flag = true;
         }
         return flag;
+#else
+        if (!gamepad_hook_state)
+            return false;
+        rescan = true;
+        wake();
+        return true;
+#endif
     }
 
     void end_pad_hook()
@@ -71,176 +150,341 @@ namespace gamepad
 
 #ifdef _WIN32
         CloseHandle(hook_thread);
+#else
+        if (!gamepad_hook_state)
+            return;
+        wake();
+        pthread_join(game_pad_hook_thread, nullptr);
+        close_fds();
+        gamepad_hook_state = false;
 #endif
     }
 
-    /* Background process for quering game pads */
 #ifdef _WIN32
-    DWORD WINAPI hook_method(const LPVOID arg)
-#else
-    void* hook_method(void *)
-#endif
+    void process_state(const uint8_t id, xinput_fix::gamepad* pad)
     {
-        while (gamepad_hook_run_flag)
+        dpad_direction dir[] = {DPAD_CENTER, DPAD_CENTER};
+
+        for (const auto& button : pad_keys)
         {
-            if (!hook::input_data)
-                break;
-            for (auto& pad : pad_states)
-            {
-                if (!pad.valid())
-                    continue;
+            hook::input_data->set_gamepad_button(id, to_vc(button),
+                pressed(pad, button));
+        }
 
-#ifdef _WIN32
-                dpad_direction dir[] = {DPAD_CENTER, DPAD_CENTER};
+        /* Dpad direction */
+        get_dpad(pad, dir);
+        hook::input_data->set_gamepad_dpad(id, dir[0], dir[1]);
 
-                for (const auto& button : pad_keys)
-                {
-                    const auto state = pressed(pad.get_xinput(), button);
-                    hook::input_data->add_gamepad_data(pad.get_id(), to_vc(button),
-                        new element_data_button(state));
-                }
+        /* Analog sticks */
+        stick_state stick;
+        stick.left_state = pressed(pad, xinput_fix::CODE_LEFT_THUMB);
+        stick.right_state = pressed(pad, xinput_fix::CODE_RIGHT_THUMB);
+        stick.left = { stick_l_x(pad), -stick_l_y(pad) };
+        stick.right = { stick_r_x(pad), -stick_r_y(pad) };
+        hook::input_data->set_gamepad_stick(id, stick);
 
-                /* Dpad direction */
-                get_dpad(pad.get_xinput(), dir);
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_DPAD_DATA,
-                    new element_data_dpad(dir[0], dir[1]));
-
-                /* Analog sticks */
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA,
-                    new element_data_analog_stick(
-                        pressed(pad.get_xinput(), xinput_fix::CODE_LEFT_THUMB),
-                        pressed(pad.get_xinput(), xinput_fix::CODE_RIGHT_THUMB),
-                        stick_l_x(pad.get_xinput()), -stick_l_y(pad.get_xinput()),
-                        stick_r_x(pad.get_xinput()), -stick_r_y(pad.get_xinput())
-                    ));
-
-                /* Trigger buttons */
-                hook::input_data->add_gamepad_data(pad.get_id(), VC_TRIGGER_DATA,
-                    new element_data_trigger(
-                        trigger_l(pad.get_xinput()), trigger_r(pad.get_xinput())
-                    ));
+        /* Trigger buttons */
+        hook::input_data->set_gamepad_trigger(id, trigger_l(pad), trigger_r(pad));
+    }
 #else
-                unsigned char m_packet[8];
-                fread(m_packet, sizeof(char) * 8, 1, pad.dev());
-                
-                if (m_packet[ID_TYPE] == ID_BUTTON) {
-                    switch(m_packet[ID_KEY_CODE])
+    void process_sample(const uint8_t id, const recording::xinput_sample& sample)
+    {
+        gamepad_data pad;
+        const float sticks[] = {
+            sample.left_x / SAMPLE_STICK_MAX, sample.left_y / SAMPLE_STICK_MAX,
+            sample.right_x / SAMPLE_STICK_MAX, sample.right_y / SAMPLE_STICK_MAX
+        };
+
+        pad.set_xinput(sample.buttons, sticks, sample.left_trigger / SAMPLE_TRIGGER_MAX,
+            sample.right_trigger / SAMPLE_TRIGGER_MAX);
+        hook::input_data->set_gamepad(id, pad);
+    }
+
+    static float packet_axis(const unsigned char value)
+    {
+        if (value < 128)
+            return UTIL_CLAMP(-1.f, value / STICK_MAX_VAL, 1.f);
+        return UTIL_CLAMP(-1.f, (value - 255) / STICK_MAX_VAL, 1.f);
+    }
+
+    void process_packet(const uint8_t id, const unsigned char* packet)
+    {
+        const auto state = packet[ID_STATE_1] == ID_PRESSED ? STATE_PRESSED : STATE_RELEASED;
+
+        if (packet[ID_TYPE] == ID_BUTTON) {
+            switch(packet[ID_KEY_CODE])
+            {
+                case PAD_L_ANALOG:
+                    hook::input_data->set_gamepad_stick_button(id, SIDE_LEFT, state);
+                    break;
+                case PAD_R_ANALOG:
+                    hook::input_data->set_gamepad_stick_button(id, SIDE_RIGHT, state);
+                    break;
+                default:
+                    switch(packet[ID_KEY_CODE])
                     {
-                        case PAD_L_ANALOG:
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA,
-                                new element_data_analog_stick(m_packet[ID_STATE_1] == ID_PRESSED ?
-                                STATE_PRESSED : STATE_RELEASED, SIDE_LEFT));
+                        case PAD_DPAD_DOWN:
+                            hook::input_data->set_gamepad_dpad(id, DPAD_DOWN, state);
                             break;
-                        case PAD_R_ANALOG:
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA,
-                                new element_data_analog_stick(m_packet[ID_STATE_1] == ID_PRESSED ?
-                                STATE_PRESSED : STATE_RELEASED, SIDE_RIGHT));
+                        case PAD_DPAD_UP:
+                            hook::input_data->set_gamepad_dpad(id, DPAD_UP, state);
                             break;
-                        default:
-                            switch(m_packet[ID_KEY_CODE])
-                            {
-                                case PAD_DPAD_DOWN:
-                                    hook::input_data->add_gamepad_data(pad.get_id(),
-                                        VC_DPAD_DATA, new element_data_dpad(
-                                            DPAD_DOWN, m_packet[ID_STATE_1] == ID_PRESSED ?
-                                                       STATE_PRESSED : STATE_RELEASED
-                                            ));
-                                break;
-                                case PAD_DPAD_UP:
-                                    hook::input_data->add_gamepad_data(pad.get_id(),
-                                                                       VC_DPAD_DATA, new element_data_dpad(
-                                            DPAD_UP, m_packet[ID_STATE_1] == ID_PRESSED ?
-                                                       STATE_PRESSED : STATE_RELEASED
-                                        ));
-                                    break;
-                                case PAD_DPAD_LEFT:
-                                    hook::input_data->add_gamepad_data(pad.get_id(),
-                                        VC_DPAD_DATA, new element_data_dpad(
-                                            DPAD_LEFT, m_packet[ID_STATE_1] == ID_PRESSED ?
-                                                       STATE_PRESSED : STATE_RELEASED
-                                        ));
-                                    break;
-                                case PAD_DPAD_RIGHT:
-                                    hook::input_data->add_gamepad_data(pad.get_id(),
-                                        VC_DPAD_DATA, new element_data_dpad(
-                                            DPAD_RIGHT, m_packet[ID_STATE_1] == ID_PRESSED ?
-                                                       STATE_PRESSED : STATE_RELEASED
-                                        ));
-                                    break;
-                                default: ;
-                            }
-                            hook::input_data->add_gamepad_data(pad.get_id(),
-                                PAD_TO_VC(m_packet[ID_KEY_CODE]),
-                                new element_data_button(m_packet[ID_STATE_1] == ID_PRESSED ?
-                                STATE_PRESSED : STATE_RELEASED));
-                    }
-                } else {
-                    float axis;
-                    switch (m_packet[ID_KEY_CODE]) {
-                        case ID_L_TRIGGER:
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_TRIGGER_DATA,
-                                new element_data_trigger(T_DATA_LEFT,
-                                    m_packet[ID_STATE_1] / 255.f));
-                            break;
-                        case ID_R_TRIGGER:
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_TRIGGER_DATA,
-                                new element_data_trigger(T_DATA_RIGHT,
-                                m_packet[ID_STATE_1] / 255.f));
-                            break;
-                        case ID_R_ANALOG_X:
-                            if (m_packet[ID_STATE_2] < 128)
-                                axis = UTIL_CLAMP(-1.f, (m_packet[ID_STATE_2]) / STICK_MAX_VAL, 1.f);
-                            else
-                                axis = UTIL_CLAMP(-1.f,
-                                    (m_packet[ID_STATE_2] - 255) / STICK_MAX_VAL, 1.f);
-                            
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA, new element_data_analog_stick(axis,
-                                STICK_STATE_RIGHT_X));
-                            break;
-                        case ID_R_ANALOG_Y:
-                            if (m_packet[ID_STATE_2] < 128)
-                                axis = UTIL_CLAMP(-1.f, (m_packet[ID_STATE_2]) / STICK_MAX_VAL, 1.f);
-                            else
-                                axis = UTIL_CLAMP(-1.f, (m_packet[ID_STATE_2] - 255) /
-                                STICK_MAX_VAL, 1.f);
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA, new element_data_analog_stick(axis,
-                                STICK_STATE_RIGHT_Y));
-                            break;
-                        case ID_L_ANALOG_X:
-                            if (m_packet[ID_STATE_2] < 128)
-                                axis = UTIL_CLAMP(-1.f, (m_packet[ID_STATE_2]) / STICK_MAX_VAL, 1.f);
-                            else
-                                axis = UTIL_CLAMP(-1.f, (m_packet[ID_STATE_2] - 255) / STICK_MAX_VAL, 1.f);
-        
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA, new element_data_analog_stick(axis,
-                                STICK_STATE_LEFT_X));
+                        case PAD_DPAD_LEFT:
+                            hook::input_data->set_gamepad_dpad(id, DPAD_LEFT, state);
                             break;
-                        case ID_L_ANALOG_Y:
-                            if (m_packet[ID_STATE_2] < 128)
-                                axis = UTIL_CLAMP(-1.f, ((float) m_packet[ID_STATE_2]) / STICK_MAX_VAL, 1.f);
-                            else
-                                axis = UTIL_CLAMP(-1.f, ((float) m_packet[ID_STATE_2] - 255) / STICK_MAX_VAL, 1.f);
-        
-                            hook::input_data->add_gamepad_data(pad.get_id(), VC_STICK_DATA, new element_data_analog_stick(axis,
-                                STICK_STATE_LEFT_Y));
+                        case PAD_DPAD_RIGHT:
+                            hook::input_data->set_gamepad_dpad(id, DPAD_RIGHT, state);
                             break;
                         default: ;
                     }
+                    hook::input_data->set_gamepad_button(id,
+                        PAD_TO_VC(packet[ID_KEY_CODE]), state);
+            }
+        } else {
+            switch (packet[ID_KEY_CODE]) {
+                case ID_L_TRIGGER:
+                    hook::input_data->set_gamepad_trigger(id, SIDE_LEFT,
+                        packet[ID_STATE_1] / 255.f);
+                    break;
+                case ID_R_TRIGGER:
+                    hook::input_data->set_gamepad_trigger(id, SIDE_RIGHT,
+                        packet[ID_STATE_1] / 255.f);
+                    break;
+                case ID_R_ANALOG_X:
+                    hook::input_data->set_gamepad_axis(id, STICK_STATE_RIGHT_X,
+                        packet_axis(packet[ID_STATE_2]));
+                    break;
+                case ID_R_ANALOG_Y:
+                    hook::input_data->set_gamepad_axis(id, STICK_STATE_RIGHT_Y,
+                        packet_axis(packet[ID_STATE_2]));
+                    break;
+                case ID_L_ANALOG_X:
+                    hook::input_data->set_gamepad_axis(id, STICK_STATE_LEFT_X,
+                        packet_axis(packet[ID_STATE_2]));
+                    break;
+                case ID_L_ANALOG_Y:
+                    hook::input_data->set_gamepad_axis(id, STICK_STATE_LEFT_Y,
+                        packet_axis(packet[ID_STATE_2]));
+                    break;
+                default: ;
+            }
+        }
+    }
+#endif
+
+#ifdef LINUX
+    /* Records a pad's new state and shows it, unless a recording is replayed */
+    static void publish(const uint8_t id, const recording::xinput_sample& sample)
+    {
+        recording::record_sample(id, sample);
+        if (!recording::is_replaying())
+            process_sample(id, sample);
+    }
+
+    static void remove_pad(GamepadState& pad)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pad.dev().fd(), nullptr);
+        pad.unload();
+
+        /* Nothing stays pressed */
+        publish(pad.get_id(), recording::xinput_sample());
+    }
+
+    static GamepadState* find_pad(const std::string& path)
+    {
+        for (auto& pad : pad_states)
+        {
+            if (pad.valid() && pad.dev().path() == path)
+                return &pad;
+        }
+        return nullptr;
+    }
+
+    /* Opens path into the first free slot, if it's a gamepad that isn't open yet */
+    static void attach_pad(const std::string& path)
+    {
+        if (find_pad(path))
+            return;
+
+        for (auto& pad : pad_states)
+        {
+            if (pad.valid())
+                continue;
+
+            if (!pad.load(path))
+                return;
+
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.u32 = pad.get_id();
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pad.dev().fd(), &ev) == -1)
+            {
+                pad.unload();
+                return;
+            }
+
+            blog(LOG_INFO, "[input-overlay] Gamepad %i is %s", pad.get_id(), path.c_str());
+            publish(pad.get_id(), pad.dev().state());
+            return;
+        }
+    }
+
+    static void detach_pad(GamepadState& pad)
+    {
+        blog(LOG_INFO, "[input-overlay] Gamepad %i disconnected", pad.get_id());
+        remove_pad(pad);
+    }
+
+    /* Drops pads whose device is gone and opens all new ones */
+    static void scan_pads()
+    {
+        for (auto& pad : pad_states)
+        {
+            if (pad.valid() && access(pad.dev().path().c_str(), F_OK) == -1)
+                detach_pad(pad);
+        }
+
+        std::vector<int> numbers;
+        if (const auto dir = opendir(EVDEV_DIR))
+        {
+            while (const auto entry = readdir(dir))
+            {
+                int number;
+                if (sscanf(entry->d_name, "event%d", &number) == 1)
+                    numbers.emplace_back(number);
+            }
+            closedir(dir);
+        }
+
+        /* Pads present at startup get their ids in the order of the devices */
+        std::sort(numbers.begin(), numbers.end());
+        for (const auto number : numbers)
+            attach_pad(EVDEV_DIR "/event" + std::to_string(number));
+    }
+
+    /* Device nodes show up before udev grants access to them,
+     * so opening is tried again once their attributes change */
+    static void read_notifications()
+    {
+        alignas(inotify_event) char buffer[NOTIFY_BUFFER_SIZE];
+
+        for (;;)
+        {
+            const auto length = read(notify_fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return;
+
+            for (auto ptr = buffer; ptr < buffer + length;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    scan_pads();
+                    continue;
                 }
 
-#endif /* LINUX */
+                if (!event->len || strncmp(event->name, "event", 5) != 0)
+                    continue;
+
+                const auto path = std::string(EVDEV_DIR "/") + event->name;
+                if (event->mask & IN_DELETE)
+                {
+                    if (const auto pad = find_pad(path))
+                        detach_pad(*pad);
+                }
+                else
+                {
+                    attach_pad(path);
+                }
             }
-#ifdef  _WIN32 /* Delay on linux results in buffered input */
-            os_sleep_ms(25);
-#endif
         }
+    }
+#endif
 
-        //for (auto& state : pad_states)
-        //    state.unload();
+    /* Background process for quering game pads */
 #ifdef _WIN32
+    DWORD WINAPI hook_method(const LPVOID arg)
+    {
+        while (gamepad_hook_run_flag)
+        {
+            if (!hook::input_data)
+                break;
+            for (auto& pad : pad_states)
+            {
+                if (!pad.valid())
+                    continue;
+
+                recording::record_xinput(pad.get_id(), pad.get_xinput());
+                if (!recording::is_replaying())
+                    process_state(pad.get_id(), pad.get_xinput());
+            }
+            os_sleep_ms(25);
+        }
         return UIOHOOK_SUCCESS;
+    }
 #else
-        pthread_exit(nullptr);
-#endif
+    /* Sleeps until any pad sent something, so an idle
+     * pad never holds up the others */
+    void* hook_method(void*)
+    {
+        epoll_event events[HOOK_PAD_COUNT + 2];
+
+        for (uint8_t id = 0; id < HOOK_PAD_COUNT; id++)
+            pad_states[id].init(id);
+
+        while (gamepad_hook_run_flag && hook::input_data)
+        {
+            if (rescan.exchange(false))
+                scan_pads();
+
+            const auto count = epoll_wait(epoll_fd, events, HOOK_PAD_COUNT + 2, -1);
+            if (count == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                blog(LOG_ERROR, "[input-overlay] Waiting for gamepads failed: %s", strerror(errno));
+                break;
+            }
+
+            for (auto i = 0; i < count; i++)
+            {
+                const auto id = events[i].data.u32;
+                if (id == WAKE_ID)
+                {
+                    uint64_t value;
+                    if (read(wake_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+                        blog(LOG_WARNING, "[input-overlay] Reading gamepad wake up failed");
+                    continue;
+                }
+
+                if (id == NOTIFY_ID)
+                {
+                    read_notifications();
+                    continue;
+                }
+
+                auto& pad = pad_states[id];
+                auto changed = false;
+                if (!pad.valid())
+                    continue;
+
+                /* Unplugged pads fail with ENODEV, usually
+                 * before the device node is deleted */
+                if (!pad.dev().read(changed))
+                    detach_pad(pad);
+                else if (changed)
+                {
+                    /* Everything the pad sent since the last wake up at once */
+                    publish(pad.get_id(), pad.dev().state());
+                }
+            }
+        }
+
+        for (auto& pad : pad_states)
+            pad.unload();
+        return nullptr;
     }
+#endif
 }
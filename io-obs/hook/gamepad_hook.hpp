@@ -10,11 +10,9 @@
 #ifdef _WIN32
 #include "xinput_fix.hpp"
 #else
-#include <stdio.h>
-#include <stdlib.h>
 #include <string>
-#include <malloc.h>
-#include <unistd.h>
+#include <pthread.h>
+#include "evdev_pad.hpp"
 #endif
 #include "util/util.hpp"
 
@@ -22,6 +20,11 @@ namespace gamepad
 {
     /* Linux implementation */
 #ifdef LINUX
+/* Any joystick device can take a slot, they're handed out in the order
+ * the devices show up */
+#define HOOK_PAD_COUNT  PAD_COUNT
+
+/* Layout of the joystick packets (/dev/input/jsN) older recordings contain */
 #define ID_TYPE         6
 #define ID_BUTTON       1
 #define ID_STATE_1      4
@@ -38,58 +41,38 @@ namespace gamepad
 
 struct GamepadState
 {
-	~GamepadState()
-	{
-		unload();
-	}
-
 	void unload()
 	{
-	    return;
-		if (m_device_file)
-			fclose(m_device_file);
-		m_device_file = nullptr;
+		m_device.close();
 	}
 
-	void load()
+	/* False if path isn't a gamepad */
+	bool load(const std::string& path)
 	{
-		m_device_file = fopen(m_path.c_str(), "wb+");
-		if (m_device_file)
-		{
-			void * tmp = malloc(8 * 12 * sizeof(char));
-			fread(tmp, sizeof(char) * 8 * 12, 1, m_device_file);
-			free(tmp);
-		}
-		
-#if _DEBUG
-		blog(LOG_INFO, "Gamepad %i present: %s", m_pad_id, m_device_file ? "true" : "false");
-#endif
+		return m_device.open(path);
 	}
 
-	bool valid() { return m_device_file != nullptr && m_pad_id >= 0; }
+	bool valid() const { return m_device.valid(); }
 
-	void init(uint8_t pad_id)
+	void init(const uint8_t pad_id)
 	{
-	    unload();
-	    m_pad_id = pad_id;
-		m_path.clear();
-		m_path = "/dev/input/js";
-		m_path.append(std::to_string(pad_id));
-		load();
+		unload();
+		m_pad_id = pad_id;
 	}
 
-	FILE * dev() { return m_device_file; }
+	evdev::device& dev() { return m_device; }
 
 	uint8_t get_id() const { return static_cast<uint8_t>(m_pad_id); }
 private:
-	FILE * m_device_file = nullptr;
-	std::string m_path;
+	evdev::device m_device;
 	int8_t m_pad_id = -1;
 };
 #endif /* LINUX */
 
     /* Windows implementation */
 #ifdef _WIN32
+/* XInput only knows four users */
+#define HOOK_PAD_COUNT  4
 
     static xinput_fix::gamepad_codes pad_keys[] =
     {
@@ -170,6 +153,16 @@ private:
 
     void start_pad_hook();
 
+    /* Apply one update of a pad to hook::input_data,
+     * also used to replay recorded input */
+#ifdef _WIN32
+    void process_state(uint8_t id, xinput_fix::gamepad* pad);
+#else
+    void process_sample(uint8_t id, const recording::xinput_sample& sample);
+    /* Joystick packets of recordings from before the evdev reader */
+    void process_packet(uint8_t id, const unsigned char* packet);
+#endif
+
 #ifdef _WIN32
     DWORD WINAPI hook_method(LPVOID arg);
 #else
@@ -178,10 +171,13 @@ private:
 
     void end_pad_hook();
 
+    /* Looks for pads again. On Linux the hook thread does that, so this
+     * only asks it to and returns right away. Pads plugged in or out
+     * while it runs are picked up on their own there */
     bool init_pad_devices();
 
-    /* Four structs containing info to query gamepads */
-    extern GamepadState pad_states[PAD_COUNT];
+    /* Structs containing info to query gamepads */
+    extern GamepadState pad_states[HOOK_PAD_COUNT];
     /* Init state of hook */
     extern bool gamepad_hook_state;
     /* False will end thread */
@@ -10,8 +10,8 @@
 #include "hook_helper.hpp"
 #include "../util/overlay.hpp"
 #include "../util/element/element_data_holder.hpp"
-#include "../util/element/element_mouse_wheel.hpp"
-#include "../util/element/element_button.hpp"
+#include "../util/latency.hpp"
+#include "recording.hpp"
 
 namespace hook
 {
@@ -23,9 +23,9 @@ namespace hook
 
     uint64_t last_wheel = 0; /* System time at last scroll event */
     element_data_holder* input_data = nullptr; /* Data for local input events */
+    spsc_queue<event_record, EVENT_QUEUE_SIZE> event_queue;
     wint_t last_character;
-    int16_t mouse_x, mouse_y, mouse_x_smooth, mouse_y_smooth, mouse_last_x,
-            mouse_last_y;
+    mouse_coalescer mouse_motion;
     bool hook_initialized = false;
 	bool data_initialized = false;
 #ifdef _WIN32
@@ -76,7 +76,98 @@ namespace hook
 			pthread_mutex_unlock(&hook_running_mutex);
 #endif
         }
-        process_event(event);
+        queue_event(event);
+    }
+
+    void queue_event(uiohook_event* const event)
+    {
+        event_record record = {};
+        record.time = os_gettime_ns();
+        record.type = static_cast<uint16_t>(event->type);
+
+        switch (event->type)
+        {
+        case EVENT_KEY_PRESSED:
+        case EVENT_KEY_RELEASED:
+            record.code = event->data.keyboard.keycode;
+            break;
+        case EVENT_KEY_TYPED:
+            record.code = event->data.keyboard.keychar;
+            break;
+        case EVENT_MOUSE_PRESSED:
+        case EVENT_MOUSE_RELEASED:
+        case EVENT_MOUSE_DRAGGED:
+        case EVENT_MOUSE_MOVED:
+            record.code = event->data.mouse.button;
+            record.x = event->data.mouse.x;
+            record.y = event->data.mouse.y;
+            break;
+        case EVENT_MOUSE_WHEEL:
+            record.x = event->data.wheel.rotation;
+            break;
+        default:
+            return; /* Not used by process_event */
+        }
+
+        recording::record_event(record);
+
+        if (record.type == EVENT_MOUSE_MOVED || record.type == EVENT_MOUSE_DRAGGED)
+        {
+            if (!recording::is_replaying())
+                mouse_motion.move(record.x, record.y);
+            return;
+        }
+
+        /* If the ring is full the event is dropped,
+         * the hook thread should never block
+         */
+        event_queue.push(record);
+    }
+
+    void process_queue(void* data, float seconds)
+    {
+        UNUSED_PARAMETER(data);
+        UNUSED_PARAMETER(seconds);
+
+        if (!input_data)
+            return;
+
+        /* Live input is dropped while a recording is replayed */
+        const auto replaying = recording::is_replaying();
+        event_queue.drain([replaying](const event_record& e)
+        {
+            if (replaying)
+                return;
+            latency::record(latency::STAGE_QUEUE, e.time);
+            input_data->set_event_time(e.time);
+            process_event(e);
+        });
+        recording::replay_tick(os_gettime_ns());
+        recording::write_queued();
+        process_mouse();
+
+        /* Scroll wheel has no release event, so reset it after a while */
+        if (last_wheel != 0 && os_gettime_ns() - last_wheel >= SCROLL_TIMEOUT)
+        {
+            input_data->set_wheel(WHEEL_DIR_NONE, 0);
+            last_wheel = 0;
+        }
+
+        input_data->publish();
+    }
+
+    void process_mouse()
+    {
+        const auto motion = mouse_motion.take();
+        if (!motion.valid)
+            return;
+
+        mouse_state mouse;
+        mouse.x = motion.x;
+        mouse.y = motion.y;
+        mouse.dx = motion.dx;
+        mouse.dy = motion.dy;
+        input_data->set_mouse(mouse);
     }
 
 #ifdef _WIN32
@@ -137,6 +228,7 @@ namespace hook
 
     void end_hook()
     {
+        obs_remove_tick_callback(process_queue, nullptr);
 #ifdef _WIN32
         /* Create event handles for the thread hook. */
         CloseHandle(hook_thread);
@@ -174,6 +266,9 @@ namespace hook
         /* Set the event callback for uiohook events. */
         hook_set_dispatch_proc(&dispatch_proc);
 
+        /* Queued events are applied before sources tick and render */
+        obs_add_tick_callback(process_queue, nullptr);
+
         const auto status = hook_enable();
         switch (status)
         {
@@ -243,80 +338,51 @@ namespace hook
         }
     }
 
-    void process_event(uiohook_event* const event)
+    void process_event(const event_record& event)
     {
-        element_data* d = nullptr;
-        element_data_wheel* wheel = nullptr;
         wheel_direction dir;
-        auto new_amount = 0;
-
-        if (input_data) d = input_data->get_by_code(VC_MOUSE_WHEEL);
 
-        if (d)
-            wheel = reinterpret_cast<element_data_wheel*>(d);
-
-        switch (event->type)
+        switch (event.type)
         {
         case EVENT_KEY_PRESSED:
-            input_data->add_data(event->data.keyboard.keycode,
-                new element_data_button(STATE_PRESSED));
+            input_data->set_button(event.code, STATE_PRESSED);
             break;
         case EVENT_KEY_RELEASED:
-            input_data->remove_data(event->data.keyboard.keycode);
+            input_data->set_button(event.code, STATE_RELEASED);
             break;
         case EVENT_MOUSE_PRESSED:
-            if (event->data.mouse.button == MOUSE_BUTTON3)
+            if (event.code == MOUSE_BUTTON3)
                 /* Special case :/ */
-                input_data->add_data(VC_MOUSE_WHEEL,
-                    new element_data_wheel(STATE_PRESSED));
+                input_data->set_wheel_button(STATE_PRESSED);
             else
-                input_data->add_data(util_mouse_to_vc(event->data.mouse.button),
-                    new element_data_button(STATE_PRESSED));
+                input_data->set_button(util_mouse_to_vc(event.code), STATE_PRESSED);
             break;
         case EVENT_MOUSE_RELEASED:
-            if (event->data.mouse.button == MOUSE_BUTTON3)
+            if (event.code == MOUSE_BUTTON3)
                 /* Special case :/ */
-                input_data->add_data(VC_MOUSE_WHEEL,
-                    new element_data_wheel(STATE_RELEASED));
+                input_data->set_wheel_button(STATE_RELEASED);
             else
-                input_data->add_data(util_mouse_to_vc(event->data.mouse.button),
-                    new element_data_button(STATE_RELEASED));
+                input_data->set_button(util_mouse_to_vc(event.code), STATE_RELEASED);
             break;
         case EVENT_MOUSE_WHEEL:
+            /* Not event.time, replayed events carry the time they
+             * were recorded at, which process_queue would see as
+             * long expired */
             last_wheel = os_gettime_ns();
-            if (event->data.wheel.rotation >= WHEEL_DOWN)
+            if (event.x >= WHEEL_DOWN)
                 dir = WHEEL_DIR_DOWN;
             else
                 dir = WHEEL_DIR_UP;
 
-            if (wheel)
-            {
-                if (dir != wheel->get_dir())
-                    new_amount = event->data.wheel.rotation;
-                else
-                    new_amount = wheel->get_amount() + event->data.wheel.rotation;
-            }
-            else
-            {
-                new_amount = event->data.wheel.rotation;
-            }
-
-            input_data->add_data(
-                VC_MOUSE_WHEEL, new element_data_wheel(dir, new_amount));
+            input_data->add_wheel(dir, event.x);
             break;
         case EVENT_KEY_TYPED:
-            last_character = event->data.keyboard.keychar;
+            last_character = event.code;
             break;
         case EVENT_MOUSE_DRAGGED:
         case EVENT_MOUSE_MOVED:
-            mouse_last_x = mouse_x;
-            mouse_last_y = mouse_y;
-            mouse_x = event->data.mouse.x;
-            mouse_y = event->data.mouse.y;
-            mouse_x_smooth = static_cast<uint16_t>((mouse_last_x * 4 + mouse_x + 4
-            ) / 5);
-            mouse_y_smooth = static_cast<uint16_t>((mouse_last_y * 4 + mouse_y + 4
-            ) / 5);
+            /* Only replayed movement ends up here, see queue_event */
+            mouse_motion.move(event.x, event.y);
             break;
         default: ;
         }
@@ -9,6 +9,8 @@
 
 #include <uiohook.h>
 #include "../util/util.hpp"
+#include "../util/spsc_queue.hpp"
+#include "../util/mouse_coalescer.hpp"
 
 #ifdef LINUX
 #include <stdint.h>
@@ -18,14 +20,33 @@
 
 class element_data_holder;
 
+/* Has to be a power of two */
+#define EVENT_QUEUE_SIZE 1024
+
 namespace hook
 {
+    /* Compact copy of the uiohook event fields
+     * which are used by process_event
+     */
+    struct event_record
+    {
+        uint64_t time;  /* os_gettime_ns() when the hook received the event */
+        uint16_t type;  /* event_type */
+        uint16_t code;  /* Key code, mouse button or typed character */
+        int16_t x, y;   /* Mouse position, x holds the rotation for wheel events */
+    };
+
+    /* Filled by the hook thread, drained once per frame by the graphics thread */
+    extern spsc_queue<event_record, EVENT_QUEUE_SIZE> event_queue;
+
     extern element_data_holder* input_data;
 
     extern uint64_t last_wheel;
     extern wint_t last_character;
-    extern int16_t mouse_x, mouse_y, mouse_x_smooth, mouse_y_smooth, mouse_last_x,
-                   mouse_last_y;
+
+    /* Mouse movement skips the event queue, the hook only keeps the
+     * latest position which process_queue picks up once per frame */
+    extern mouse_coalescer mouse_motion;
     extern bool hook_initialized;
 	extern bool data_initialized;
 
@@ -37,6 +58,14 @@ namespace hook
 
     void dispatch_proc(uiohook_event* event);
 
+    void queue_event(uiohook_event* event);
+
+    /* Tick callback, applies all queued events to input_data and publishes them */
+    void process_queue(void* data, float seconds);
+
+    /* Publishes the coalesced mouse movement of the last frame */
+    void process_mouse();
+
     bool logger_proc(unsigned int level, const char* format, ...);
 
 	void init_data_holder();
@@ -47,5 +76,5 @@ namespace hook
 
     int hook_enable();
 
-    void process_event(uiohook_event* event);
+    void process_event(const event_record& event);
 };
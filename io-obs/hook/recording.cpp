@@ -0,0 +1,559 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <util/platform.h>
+#include "recording.hpp"
+#include "gamepad_hook.hpp"
+#include "../util/spsc_queue.hpp"
+
+/* The buffer is written out once it's this full */
+#define FLUSH_SIZE (64 * 1024)
+
+#ifdef _WIN32
+#define REC_PLATFORM REC_PLATFORM_WINDOWS
+#else
+#define REC_PLATFORM REC_PLATFORM_LINUX
+#endif
+
+namespace recording
+{
+    static writer local_writer;
+    static std::atomic<bool> recording_flag{false};
+
+    /* One ring per producer, the hook thread and the gamepad thread.
+     * Whoever holds queue_lock drains them */
+    static spsc_queue<record, REC_QUEUE_SIZE> event_records;
+    static spsc_queue<record, REC_QUEUE_SIZE> pad_records;
+    static std::vector<record> queued_events, queued_pads;
+    static std::mutex queue_lock;
+    static size_t dropped_at_start = 0;
+
+    static std::unique_ptr<player> local_player;
+    static std::mutex player_lock;
+    static std::atomic<bool> replay_flag{false};
+
+    /* writer */
+
+    writer::~writer()
+    {
+        close();
+    }
+
+    bool writer::open(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_file)
+            return false;
+
+        m_file = fopen(path.c_str(), "wb");
+        if (!m_file)
+            return false;
+
+        m_buffer.clear();
+        m_buffer.reserve(FLUSH_SIZE + 64);
+        m_last_time = os_gettime_ns();
+
+        for (auto i = 0; i < 4; i++)
+            put(REC_MAGIC[i]);
+        put(REC_VERSION);
+        put(REC_PLATFORM);
+        put(0);
+        put(0);
+        for (auto i = 0; i < 8; i++)
+            put(static_cast<uint8_t>(m_last_time >> i * 8));
+        return true;
+    }
+
+    void writer::close()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_file)
+            return;
+
+        flush();
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+    void writer::write(const record& r)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_file)
+            return;
+
+        /* Hook and gamepad thread take their time stamps before locking,
+         * so they can be slightly out of order. File order wins */
+        const auto time = r.time > m_last_time ? r.time : m_last_time;
+        put_varint(time - m_last_time);
+        m_last_time = time;
+        put(static_cast<uint8_t>(r.kind));
+
+        switch (r.kind)
+        {
+        case REC_EVENT:
+            put_varint(r.event.type);
+            put_varint(r.event.code);
+            put_zigzag(r.event.x);
+            put_zigzag(r.event.y);
+            break;
+        case REC_PAD_PACKET:
+            put(r.pad);
+            for (const auto b : r.packet)
+                put(b);
+            break;
+        case REC_PAD_XINPUT:
+            put(r.pad);
+            put_varint(r.xinput.buttons);
+            put(r.xinput.left_trigger);
+            put(r.xinput.right_trigger);
+            put_zigzag(r.xinput.left_x);
+            put_zigzag(r.xinput.left_y);
+            put_zigzag(r.xinput.right_x);
+            put_zigzag(r.xinput.right_y);
+            break;
+        default: ;
+        }
+
+        if (m_buffer.size() >= FLUSH_SIZE)
+            flush();
+    }
+
+    void writer::put(const uint8_t byte)
+    {
+        m_buffer.push_back(byte);
+    }
+
+    void writer::put_varint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            put(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        put(static_cast<uint8_t>(value));
+    }
+
+    void writer::put_zigzag(const int64_t value)
+    {
+        put_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writer::flush()
+    {
+        if (!m_buffer.empty())
+            fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+        m_buffer.clear();
+    }
+
+    /* reader */
+
+    bool reader::load(const std::string& path)
+    {
+        m_data.clear();
+        m_pos = 0;
+
+        const auto file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+
+        uint8_t chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+            m_data.insert(m_data.end(), chunk, chunk + read);
+        fclose(file);
+
+        if (m_data.size() < REC_HEADER_SIZE || memcmp(m_data.data(), REC_MAGIC, 4) != 0)
+        {
+            blog(LOG_WARNING, "[input-overlay] %s is not an input recording", path.c_str());
+            return false;
+        }
+
+        if (m_data[4] != REC_VERSION)
+        {
+            blog(LOG_WARNING, "[input-overlay] Input recording %s has unsupported version %i",
+                path.c_str(), m_data[4]);
+            return false;
+        }
+
+        m_platform = m_data[5];
+        m_start_time = 0;
+        for (auto i = 0; i < 8; i++)
+            m_start_time |= static_cast<uint64_t>(m_data[8 + i]) << i * 8;
+
+        rewind();
+        return true;
+    }
+
+    bool reader::next(record& r)
+    {
+        /* Zeroed, a failed read stops the chains below early */
+        uint64_t delta = 0, v[2] = {};
+        int64_t s[4] = {};
+        uint8_t kind = 0;
+        record rec = {};
+
+        if (m_pos >= m_data.size())
+            return false;
+
+        auto valid = get_varint(delta) && get(kind);
+        rec.kind = static_cast<record_kind>(kind);
+
+        if (valid)
+        {
+            switch (rec.kind)
+            {
+            case REC_EVENT:
+                valid = get_varint(v[0]) && get_varint(v[1]) && get_zigzag(s[0]) && get_zigzag(s[1]);
+                rec.event.type = static_cast<uint16_t>(v[0]);
+                rec.event.code = static_cast<uint16_t>(v[1]);
+                rec.event.x = static_cast<int16_t>(s[0]);
+                rec.event.y = static_cast<int16_t>(s[1]);
+                break;
+            case REC_PAD_PACKET:
+                valid = get(rec.pad);
+                for (auto& b : rec.packet)
+                    valid = valid && get(b);
+                break;
+            case REC_PAD_XINPUT:
+                valid = get(rec.pad) && get_varint(v[0]) && get(rec.xinput.left_trigger) &&
+                    get(rec.xinput.right_trigger) && get_zigzag(s[0]) && get_zigzag(s[1]) &&
+                    get_zigzag(s[2]) && get_zigzag(s[3]);
+                rec.xinput.buttons = static_cast<uint16_t>(v[0]);
+                rec.xinput.left_x = static_cast<int16_t>(s[0]);
+                rec.xinput.left_y = static_cast<int16_t>(s[1]);
+                rec.xinput.right_x = static_cast<int16_t>(s[2]);
+                rec.xinput.right_y = static_cast<int16_t>(s[3]);
+                break;
+            default:
+                /* Unknown kinds can't be skipped, their size isn't known */
+                valid = false;
+            }
+        }
+
+        if (!valid)
+        {
+            blog(LOG_WARNING, "[input-overlay] Input recording is broken after %zu bytes", m_pos);
+            m_pos = m_data.size();
+            return false;
+        }
+
+        /* r is only touched once the whole record was read */
+        m_time += delta;
+        rec.time = m_time;
+        rec.event.time = m_time;
+        r = rec;
+        return true;
+    }
+
+    void reader::rewind()
+    {
+        m_pos = REC_HEADER_SIZE;
+        m_time = m_start_time;
+    }
+
+    bool reader::get(uint8_t& byte)
+    {
+        if (m_pos >= m_data.size())
+            return false;
+        byte = m_data[m_pos++];
+        return true;
+    }
+
+    bool reader::get_varint(uint64_t& value)
+    {
+        uint8_t byte;
+        value = 0;
+
+        for (auto shift = 0; shift < 64; shift += 7)
+        {
+            if (!get(byte))
+                return false;
+
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool reader::get_zigzag(int64_t& value)
+    {
+        uint64_t raw;
+        if (!get_varint(raw))
+            return false;
+        value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+        return true;
+    }
+
+    /* player */
+
+    bool player::load(const std::string& path)
+    {
+        m_has_next = false;
+        if (!m_reader.load(path))
+            return false;
+
+        if (m_reader.platform() != REC_PLATFORM)
+            blog(LOG_WARNING, "[input-overlay] %s was recorded on another platform, gamepad input"
+                " won't be replayed", path.c_str());
+        return true;
+    }
+
+    void player::start(const uint64_t now, const float speed)
+    {
+        m_reader.rewind();
+        m_start = now;
+        m_speed = speed;
+        m_skipped = 0;
+        m_applied = 0;
+        m_has_next = m_reader.next(m_next);
+    }
+
+    bool player::update(const uint64_t now)
+    {
+        if (!hook::input_data)
+            return m_has_next;
+
+        while (m_has_next)
+        {
+            if (m_speed > 0.f)
+            {
+                const auto offset = static_cast<uint64_t>((m_next.time - m_reader.start_time()) / m_speed);
+                if (m_start + offset > now)
+                    return true;
+            }
+
+            if (apply(m_next))
+                m_applied++;
+            else
+                m_skipped++;
+            m_has_next = m_reader.next(m_next);
+        }
+        return false;
+    }
+
+    bool player::apply(const record& r)
+    {
+        switch (r.kind)
+        {
+        case REC_EVENT:
+            hook::process_event(r.event);
+            break;
+#ifdef _WIN32
+        case REC_PAD_XINPUT:
+        {
+            xinput_fix::gamepad state = {};
+            state.wButtons = r.xinput.buttons;
+            state.bLeftTrigger = r.xinput.left_trigger;
+            state.bRightTrigger = r.xinput.right_trigger;
+            state.sThumbLX = r.xinput.left_x;
+            state.sThumbLY = r.xinput.left_y;
+            state.sThumbRX = r.xinput.right_x;
+            state.sThumbRY = r.xinput.right_y;
+            gamepad::process_state(r.pad, &state);
+            break;
+        }
+#else
+        case REC_PAD_XINPUT:
+            gamepad::process_sample(r.pad, r.xinput);
+            break;
+        case REC_PAD_PACKET:
+            gamepad::process_packet(r.pad, r.packet);
+            break;
+#endif
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    /* Local hooks */
+
+    static size_t dropped_records()
+    {
+        return event_records.dropped() + pad_records.dropped();
+    }
+
+    /* Has to be called with queue_lock held */
+    static void write_rings()
+    {
+        queued_events.clear();
+        queued_pads.clear();
+        event_records.drain([](const record& r) { queued_events.emplace_back(r); });
+        pad_records.drain([](const record& r) { queued_pads.emplace_back(r); });
+
+        /* Both rings are in order, merged by time so the file is too */
+        auto e = queued_events.begin();
+        auto p = queued_pads.begin();
+        while (e != queued_events.end() || p != queued_pads.end())
+        {
+            if (p == queued_pads.end() || (e != queued_events.end() && e->time <= p->time))
+                local_writer.write(*e++);
+            else
+                local_writer.write(*p++);
+        }
+    }
+
+    bool start_recording(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(queue_lock);
+
+        /* Left over from a previous recording that was stopped
+         * while a hook was queueing */
+        event_records.drain([](const record&) { });
+        pad_records.drain([](const record&) { });
+        queued_events.reserve(REC_QUEUE_SIZE);
+        queued_pads.reserve(REC_QUEUE_SIZE);
+        dropped_at_start = dropped_records();
+
+        if (!local_writer.open(path))
+        {
+            blog(LOG_WARNING, "[input-overlay] Couldn't start input recording to %s", path.c_str());
+            return false;
+        }
+
+        blog(LOG_INFO, "[input-overlay] Recording input to %s", path.c_str());
+        recording_flag = true;
+        return true;
+    }
+
+    void stop_recording()
+    {
+        std::lock_guard<std::mutex> lock(queue_lock);
+        if (!recording_flag)
+            return;
+
+        recording_flag = false;
+        write_rings();
+        local_writer.close();
+
+        const auto dropped = dropped_records() - dropped_at_start;
+        if (dropped)
+            blog(LOG_WARNING, "[input-overlay] %llu records were dropped from the recording,"
+                " the hooks queued them faster than they were written",
+                static_cast<unsigned long long>(dropped));
+    }
+
+    void write_queued()
+    {
+        if (!is_recording())
+            return;
+
+        std::lock_guard<std::mutex> lock(queue_lock);
+        if (is_recording())
+            write_rings();
+    }
+
+    /* Replayed input reaches the hooks as well, it's not recorded again */
+    static bool wants_records()
+    {
+        return is_recording() && !is_replaying();
+    }
+
+    bool is_recording()
+    {
+        return recording_flag.load(std::memory_order_relaxed);
+    }
+
+    void record_event(const hook::event_record& event)
+    {
+        if (!wants_records())
+            return;
+
+        record r = {};
+        r.time = event.time;
+        r.kind = REC_EVENT;
+        r.event = event;
+        event_records.push(r);
+    }
+
+#ifdef _WIN32
+    void record_xinput(const uint8_t pad, const xinput_fix::gamepad* state)
+    {
+        /* Pads are polled, only keep polls that changed something */
+        static unsigned long last_count[PAD_COUNT] = {};
+
+        if (!wants_records() || pad >= PAD_COUNT || last_count[pad] == state->eventCount)
+            return;
+        last_count[pad] = state->eventCount;
+
+        record r = {};
+        r.time = os_gettime_ns();
+        r.kind = REC_PAD_XINPUT;
+        r.pad = pad;
+        r.xinput.buttons = state->wButtons;
+        r.xinput.left_trigger = state->bLeftTrigger;
+        r.xinput.right_trigger = state->bRightTrigger;
+        r.xinput.left_x = state->sThumbLX;
+        r.xinput.left_y = state->sThumbLY;
+        r.xinput.right_x = state->sThumbRX;
+        r.xinput.right_y = state->sThumbRY;
+        pad_records.push(r);
+    }
+#else
+    void record_sample(const uint8_t pad, const xinput_sample& sample)
+    {
+        /* The evdev reader only reports changes */
+        if (!wants_records())
+            return;
+
+        record r = {};
+        r.time = os_gettime_ns();
+        r.kind = REC_PAD_XINPUT;
+        r.pad = pad;
+        r.xinput = sample;
+        pad_records.push(r);
+    }
+#endif
+
+    bool start_replay(const std::string& path, const float speed)
+    {
+        std::unique_ptr<player> p(new player());
+        if (!p->load(path))
+        {
+            blog(LOG_WARNING, "[input-overlay] Couldn't replay %s", path.c_str());
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(player_lock);
+        p->start(os_gettime_ns(), speed);
+        local_player = std::move(p);
+        replay_flag = true;
+        blog(LOG_INFO, "[input-overlay] Replaying %s at %.2fx speed", path.c_str(), speed);
+        return true;
+    }
+
+    void stop_replay()
+    {
+        std::lock_guard<std::mutex> lock(player_lock);
+        replay_flag = false;
+        local_player.reset();
+    }
+
+    bool is_replaying()
+    {
+        return replay_flag.load(std::memory_order_relaxed);
+    }
+
+    void replay_tick(const uint64_t now)
+    {
+        if (!is_replaying())
+            return;
+
+        std::lock_guard<std::mutex> lock(player_lock);
+        if (local_player && !local_player->update(now))
+        {
+            blog(LOG_INFO, "[input-overlay] Replay finished, %llu records were skipped",
+                static_cast<unsigned long long>(local_player->skipped()));
+            local_player.reset();
+            replay_flag = false;
+        }
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hook_helper.hpp"
+
+#ifdef _WIN32
+#include "xinput_fix.hpp"
+#endif
+
+/**
+ * Recording of the raw input the hooks receive, so it can be replayed
+ * into hook::input_data later on.
+ *
+ * File layout (all numbers little endian):
+ *   header   "IORC", version (u8), platform (u8), 2 reserved bytes,
+ *            start time in ns (u64)
+ *   records  time since the previous record in ns (varint), kind (u8),
+ *            payload depending on the kind
+ *
+ * Varints are LEB128, signed values are zigzag encoded first. Records
+ * are only ever appended and the header is never rewritten, so a file
+ * can be read (or mapped) while it's still being written, and a file cut
+ * off by a crash is valid up to the last complete record.
+ */
+
+#define REC_MAGIC           "IORC"
+#define REC_VERSION         1
+#define REC_HEADER_SIZE     16
+
+/* Records the hooks can queue per frame before they're dropped */
+#define REC_QUEUE_SIZE      4096
+
+#define REC_PLATFORM_LINUX      1
+#define REC_PLATFORM_WINDOWS    2
+
+namespace recording
+{
+    enum record_kind
+    {
+        /* hook::event_record: type, code (varints), x, y (zigzag) */
+        REC_EVENT,
+        /* Linux joystick packet: pad (u8), 8 raw bytes. Only
+         * in older recordings, Linux pads are stored as REC_PAD_XINPUT now */
+        REC_PAD_PACKET,
+        /* XInput state: pad (u8), buttons (varint), triggers (2x u8),
+         * sticks (4x zigzag) */
+        REC_PAD_XINPUT,
+        REC_KIND_COUNT
+    };
+
+    /* Platform independent copy of the XInput state */
+    struct xinput_sample
+    {
+        uint16_t buttons;
+        uint8_t left_trigger, right_trigger;
+        int16_t left_x, left_y, right_x, right_y;
+    };
+
+    struct record
+    {
+        uint64_t time; /* Same clock as os_gettime_ns() during recording */
+        record_kind kind;
+        uint8_t pad;
+        hook::event_record event;       /* REC_EVENT */
+        unsigned char packet[8];        /* REC_PAD_PACKET */
+        xinput_sample xinput;           /* REC_PAD_XINPUT */
+    };
+
+    class writer
+    {
+    public:
+        ~writer();
+
+        bool open(const std::string& path);
+        void close();
+
+        /* Can be called from any thread, but locks and writes the
+         * file, so the hooks queue their records instead */
+        void write(const record& r);
+    private:
+        void put(uint8_t byte);
+        void put_varint(uint64_t value);
+        void put_zigzag(int64_t value);
+        void flush();
+
+        FILE* m_file = nullptr;
+        std::vector<uint8_t> m_buffer;
+        uint64_t m_last_time = 0;
+        std::mutex m_lock;
+    };
+
+    class reader
+    {
+    public:
+        /* Reads the whole file into memory */
+        bool load(const std::string& path);
+
+        /* False at the end of the file or at a broken record */
+        bool next(record& r);
+
+        void rewind();
+
+        uint64_t start_time() const { return m_start_time; }
+        uint8_t platform() const { return m_platform; }
+    private:
+        bool get(uint8_t& byte);
+        bool get_varint(uint64_t& value);
+        bool get_zigzag(int64_t& value);
+
+        std::vector<uint8_t> m_data;
+        size_t m_pos = 0;
+        uint64_t m_start_time = 0;
+        uint64_t m_time = 0;
+        uint8_t m_platform = 0;
+    };
+
+    /**
+     * Feeds a recording into hook::input_data. Records are applied the
+     * same way live input is, hook events through hook::process_event,
+     * pad updates through the gamepad hook.
+     */
+    class player
+    {
+    public:
+        bool load(const std::string& path);
+
+        /* speed scales the recorded timing, 2 plays back twice as fast.
+         * With a speed of zero or less everything is applied at once */
+        void start(uint64_t now, float speed);
+
+        /* Applies all records that are due at now, false once done */
+        bool update(uint64_t now);
+
+        uint64_t applied() const { return m_applied; }
+
+        /* Records that couldn't be applied, because they were
+         * recorded on another platform */
+        uint64_t skipped() const { return m_skipped; }
+    private:
+        /* False if r can't be applied on this platform */
+        bool apply(const record& r);
+
+        reader m_reader;
+        record m_next = {};
+        bool m_has_next = false;
+        uint64_t m_start = 0;
+        float m_speed = 1.f;
+        uint64_t m_skipped = 0;
+        uint64_t m_applied = 0;
+    };
+
+    /* Recording of the local hooks */
+    bool start_recording(const std::string& path);
+    void stop_recording();
+    bool is_recording();
+
+    /* Called by the hooks, do nothing unless a recording is running and
+     * no replay is. Records are only queued, write_queued() writes them */
+    void record_event(const hook::event_record& event);
+#ifdef _WIN32
+    void record_xinput(uint8_t pad, const xinput_fix::gamepad* state);
+#else
+    void record_sample(uint8_t pad, const xinput_sample& sample);
+#endif
+
+    /* Replay into hook::input_data. Live input is ignored meanwhile */
+    bool start_replay(const std::string& path, float speed);
+    void stop_replay();
+    bool is_replaying();
+
+    /* Called once per frame by hook::process_queue */
+    void replay_tick(uint64_t now);
+    void write_queued();
+}
@@ -9,13 +9,18 @@
 #include <obs-frontend-api.h>
 #include <QMainWindow>
 #include <QAction>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QInputDialog>
 #include <util/config-file.h>
 
 #include "util/util.hpp"
+#include "util/latency.hpp"
 #include "sources/input_source.hpp"
 #include "sources/input_history.hpp"
 #include "hook/hook_helper.hpp"
 #include "hook/gamepad_hook.hpp"
+#include "hook/recording.hpp"
 #include "gui/io_settings_dialog.hpp"
 #include "network/remote_connection.hpp"
 
@@ -82,11 +87,63 @@ bool obs_module_load()
 	const auto menu_cb = [] { settings_dialog->toggleShowHide(); };
 	QAction::connect(menu_action, &QAction::triggered, menu_cb);
 
+	/* Dumps input latency percentiles to the log and a message box */
+	const auto latency_action = static_cast<QAction*>(obs_frontend_add_tools_menu_qaction(
+		T_MENU_LATENCY_STATS));
+	const auto latency_cb = [main_window]
+	{
+		const auto text = latency::summary();
+		blog(LOG_INFO, "[input-overlay] Input latency:\n%s", text.c_str());
+		QMessageBox::information(main_window, T_MENU_LATENCY_STATS, QString::fromStdString(text));
+	};
+	QAction::connect(latency_action, &QAction::triggered, latency_cb);
+
+	/* Records everything the local hooks receive until unchecked */
+	const auto record_action = static_cast<QAction*>(obs_frontend_add_tools_menu_qaction(
+		T_MENU_RECORD_INPUT));
+	record_action->setCheckable(true);
+	const auto record_cb = [main_window, record_action](const bool checked)
+	{
+		if (!checked)
+		{
+			recording::stop_recording();
+			return;
+		}
+
+		const auto filter = util_file_filter(T_RECORDING_FILES, "*.iorec");
+		const auto path = QFileDialog::getSaveFileName(main_window, T_MENU_RECORD_INPUT,
+			QString(), QString::fromStdString(filter));
+		if (path.isEmpty() || !recording::start_recording(path.toStdString()))
+			record_action->setChecked(false);
+	};
+	QAction::connect(record_action, &QAction::triggered, record_cb);
+
+	const auto replay_action = static_cast<QAction*>(obs_frontend_add_tools_menu_qaction(
+		T_MENU_REPLAY_INPUT));
+	const auto replay_cb = [main_window]
+	{
+		const auto filter = util_file_filter(T_RECORDING_FILES, "*.iorec");
+		const auto path = QFileDialog::getOpenFileName(main_window, T_MENU_REPLAY_INPUT,
+			QString(), QString::fromStdString(filter));
+		if (path.isEmpty())
+			return;
+
+		auto ok = false;
+		const auto speed = QInputDialog::getDouble(main_window, T_MENU_REPLAY_INPUT,
+			T_RECORDING_SPEED, 1.0, 0.0, 100.0, 2, &ok);
+		if (ok)
+			recording::start_replay(path.toStdString(), float(speed));
+	};
+	QAction::connect(replay_action, &QAction::triggered, replay_cb);
+
     return true;
 }
 
 void obs_module_unload()
 {
+    recording::stop_recording();
+    recording::stop_replay();
+
     if (gamepad::gamepad_hook_state)
         gamepad::end_pad_hook();
 
@@ -0,0 +1,345 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "handshake_worker.hpp"
+#include "io_server.hpp"
+#include "remote_connection.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+
+namespace network
+{
+    handshake_worker::handshake_worker(io_server* server)
+        : m_server(server)
+    {
+    }
+
+    handshake_worker::~handshake_worker()
+    {
+        stop();
+    }
+
+    bool handshake_worker::start()
+    {
+        if (!m_poller.init())
+            return false;
+
+        m_run = true;
+#ifdef _WIN32
+        m_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(thread_method),
+            this, 0, nullptr);
+        if (!m_thread)
+#else
+        m_started = pthread_create(&m_thread, nullptr, thread_method, this) == 0;
+        if (!m_started)
+#endif
+        {
+            LOG_(LOG_ERROR, "Creating handshake thread failed.");
+            m_run = false;
+            return false;
+        }
+        return true;
+    }
+
+    void handshake_worker::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_run = false;
+        }
+        m_signal.notify_one();
+#ifdef _WIN32
+        if (m_thread)
+        {
+            WaitForSingleObject(m_thread, INFINITE);
+            CloseHandle(m_thread);
+            m_thread = nullptr;
+        }
+#else
+        if (m_started)
+        {
+            pthread_join(m_thread, nullptr);
+            m_started = false;
+        }
+#endif
+        for (const auto& c : m_connections)
+        {
+            if (c->step != PHASE_DONE)
+                finish(*c, false);
+        }
+        m_connections.clear();
+
+        for (const auto socket : m_pending)
+            netlib_tcp_close(socket);
+        m_pending.clear();
+    }
+
+    void handshake_worker::add(tcp_socket socket)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_run && m_count < MAX_PENDING_HANDSHAKES)
+            {
+                m_pending.emplace_back(socket);
+                ++m_count;
+                socket = nullptr;
+            }
+        }
+
+        if (socket)
+        {
+            LOG_(LOG_ERROR, "Too many connections in their handshake, closed a new one.");
+            netlib_tcp_close(socket);
+        }
+        else
+        {
+            m_signal.notify_one();
+        }
+    }
+
+#ifdef _WIN32
+    DWORD WINAPI handshake_worker::thread_method(const LPVOID arg)
+    {
+        static_cast<handshake_worker*>(arg)->run();
+        return 0x0;
+    }
+#else
+    void* handshake_worker::thread_method(void* arg)
+    {
+        static_cast<handshake_worker*>(arg)->run();
+        return nullptr;
+    }
+#endif
+
+    void handshake_worker::run()
+    {
+        while (m_run)
+        {
+            take_new_connections();
+            if (!m_run)
+                break;
+
+            /* Until the first deadline runs out, new connections
+             * are only picked up after waiting */
+            const auto now = os_gettime_ns();
+            uint64_t wait_ns = uint64_t(HANDSHAKE_POLL_MS) * 1000 * 1000;
+            for (const auto& c : m_connections)
+                wait_ns = std::min(wait_ns, c->deadline > now ? c->deadline - now : 0);
+
+            /* Rounded up, waking up early would only spin */
+            if (m_poller.wait(m_ready, uint32_t((wait_ns + 999999) / 1000000)) == -1)
+            {
+                LOG_(LOG_ERROR, "Handshake thread failed to wait for connections.");
+                break;
+            }
+
+            for (const auto& ready : m_ready)
+            {
+                auto& c = *static_cast<connection*>(ready.user);
+                if (c.step != PHASE_DONE && !receive(c))
+                    finish(c, false);
+            }
+
+            const auto after = os_gettime_ns();
+            for (const auto& c : m_connections)
+            {
+                if (c->step != PHASE_DONE && after >= c->deadline)
+                {
+                    LOG_(LOG_ERROR, "Handshake with a new client timed out.");
+                    finish(*c, false);
+                }
+            }
+
+            m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(),
+                [](const std::unique_ptr<connection>& c) { return c->step == PHASE_DONE; }),
+                m_connections.end());
+        }
+    }
+
+    void handshake_worker::take_new_connections()
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (m_connections.empty())
+            m_signal.wait(lock, [this] { return !m_run || !m_pending.empty(); });
+
+        /* One deadline for everything, a client that answers just slowly
+         * enough for each read can't drag its handshake out */
+        const auto deadline = os_gettime_ns() + uint64_t(HANDSHAKE_DEADLINE_MS) * 1000 * 1000;
+
+        while (m_run && !m_pending.empty())
+        {
+            std::unique_ptr<connection> c(new connection());
+            c->socket = m_pending.front();
+            c->deadline = deadline;
+            c->name = static_cast<char*>(malloc(HELLO_MAX_NAME + 1));
+            m_pending.pop_front();
+
+            /* Level triggered, a connection only reads what its next
+             * step needs and leaves the rest for later */
+            if (!c->name || !m_poller.add(c->socket, c.get(), false))
+            {
+                free(c->name);
+                netlib_tcp_close(c->socket);
+                --m_count;
+                continue;
+            }
+            m_connections.emplace_back(std::move(c));
+        }
+    }
+
+    bool handshake_worker::receive(connection& c)
+    {
+        /* Readable with nothing to read means the client left */
+        const auto available = socket_poller::pending(c.socket);
+        if (!available)
+            return false;
+
+        /* Never more than the current step needs, anything after the
+         * handshake is already meant for the client's worker */
+        const auto wanted = std::min(available, c.wanted - c.size);
+        const auto result = netlib_tcp_recv(c.socket, c.data + c.size, int(wanted));
+        if (result <= 0)
+            return false;
+
+        c.size += size_t(result);
+        while (c.step != PHASE_DONE && c.size == c.wanted)
+        {
+            if (!advance(c))
+                return false;
+        }
+        return true;
+    }
+
+    bool handshake_worker::advance(connection& c)
+    {
+        frame_header header;
+
+        switch (c.step)
+        {
+        case PHASE_MAGIC:
+            /* Older clients start with the length of their name */
+            if (memcmp(c.data, FRAME_MAGIC, 2) != 0)
+            {
+                LOG_(LOG_ERROR, "Client uses the handshake of an old io-client, it has to be updated.");
+                send_message(c.socket, MSG_VERSION_UNSUPPORTED);
+                return false;
+            }
+            c.step = PHASE_HEADER;
+            c.wanted = FRAME_HEADER_SIZE;
+            return true;
+        case PHASE_HEADER:
+            if (!read_any_frame_header(c.data, header) || header.msg != MSG_HELLO ||
+                header.length > HELLO_SIZE + HELLO_MAX_NAME)
+            {
+                LOG_(LOG_ERROR, "Failed to receive hello.");
+                return false;
+            }
+            c.step = PHASE_HELLO;
+            c.wanted = FRAME_HEADER_SIZE + header.length;
+            return true;
+        case PHASE_HELLO:
+            return answer_hello(c);
+        case PHASE_SYNC:
+        {
+            if (!read_frame_header(c.data, header) || header.msg != MSG_TIME_SYNC)
+                return false;
+            const auto received = os_gettime_ns() / 1000;
+
+            /* The client read its clock about halfway through the round trip,
+             * the shortest round trip has the least room for error */
+            if (received - c.ping_sent < c.sync.rtt)
+            {
+                c.sync.rtt = received - c.ping_sent;
+                c.sync.offset = int64_t(header.time) - int64_t(c.ping_sent + c.sync.rtt / 2);
+            }
+
+            if (++c.round < SYNC_ROUNDS)
+                return send_ping(c);
+
+            LOG_(LOG_INFO, "Clock of %s is %lldus off, round trip took %lluus.", c.name,
+                static_cast<long long>(c.sync.offset), static_cast<unsigned long long>(c.sync.rtt));
+            finish(c, true);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool handshake_worker::answer_hello(connection& c)
+    {
+        frame_header header;
+        if (!read_any_frame_header(c.data, header) ||
+            !read_hello(c.data + FRAME_HEADER_SIZE, header, c.client, c.name))
+        {
+            LOG_(LOG_ERROR, "Failed to receive hello.");
+            return false;
+        }
+
+        const auto server = m_server->capabilities();
+        uint8_t answer[FRAME_HEADER_SIZE + HELLO_SIZE];
+        auto msg = MSG_HELLO;
+
+        c.client.version = std::min(c.client.version, server.version);
+        c.client.caps &= server.caps;
+        c.client.pads = std::min(c.client.pads, server.pads);
+
+        if (c.client.version < FRAME_MIN_VERSION)
+        {
+            LOG_(LOG_ERROR, "%s uses protocol version %i, at least %i is needed.", c.name,
+                c.client.version, FRAME_MIN_VERSION);
+            msg = MSG_VERSION_UNSUPPORTED;
+        }
+
+        const auto size = write_hello(answer, msg, c.client, nullptr, os_gettime_ns() / 1000);
+        if (netlib_tcp_send(c.socket, answer, int(size)) != int(size) || msg != MSG_HELLO)
+            return false;
+
+        if (c.client.has(CAP_TIMESTAMPS))
+        {
+            /* Pings the client to find out how its clock relates to ours */
+            c.step = PHASE_SYNC;
+            c.sync.rtt = UINT64_MAX;
+            return send_ping(c);
+        }
+
+        finish(c, true);
+        return true;
+    }
+
+    bool handshake_worker::send_ping(connection& c)
+    {
+        c.size = 0;
+        c.wanted = FRAME_HEADER_SIZE;
+        c.ping_sent = os_gettime_ns() / 1000;
+        return send_message(c.socket, MSG_TIME_SYNC) != 0;
+    }
+
+    void handshake_worker::finish(connection& c, const bool success)
+    {
+        if (!success && c.step == PHASE_SYNC)
+        {
+            LOG_(LOG_ERROR, "Clock synchronization with %s failed.", c.name);
+        }
+
+        m_poller.remove(c.socket);
+        c.step = PHASE_DONE;
+        --m_count;
+
+        if (success)
+        {
+            m_server->add_client(c.socket, c.name, c.client, c.sync);
+        }
+        else
+        {
+            free(c.name);
+            netlib_tcp_close(c.socket);
+        }
+        c.name = nullptr;
+    }
+}
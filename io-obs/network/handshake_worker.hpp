@@ -0,0 +1,114 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <netlib.h>
+#include "socket_poller.hpp"
+#include "protocol.hpp"
+#include "jitter_buffer.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Connections in their handshake at once, more are turned away */
+#define MAX_PENDING_HANDSHAKES 16
+/* Longest new connections wait while others are in their handshake */
+#define HANDSHAKE_POLL_MS 10
+
+namespace network
+{
+    class io_server;
+
+    /**
+     * Thread that runs the handshakes of accepted connections and hands
+     * them to the server afterwards. The accept thread also receives all
+     * datagrams, so it can't wait for slow clients. All handshakes run at
+     * once, each connection only reads what arrived and moves on to its
+     * next step, so a slow or silent peer only holds up itself until its
+     * HANDSHAKE_DEADLINE_MS ran out.
+     */
+    class handshake_worker
+    {
+    public:
+        explicit handshake_worker(io_server* server);
+        ~handshake_worker();
+
+        bool start();
+        /* Waits for the thread to exit, closes connections still waiting */
+        void stop();
+
+        /* Called by the accept thread, takes over the socket */
+        void add(tcp_socket socket);
+    private:
+        enum phase
+        {
+            PHASE_MAGIC,    /* First two bytes, to tell old clients apart */
+            PHASE_HEADER,   /* Rest of the hello's frame header */
+            PHASE_HELLO,    /* Hello payload */
+            PHASE_SYNC,     /* Answer to a clock ping */
+            PHASE_DONE
+        };
+
+        struct connection
+        {
+            tcp_socket socket;
+            uint64_t deadline;  /* os_gettime_ns() */
+            phase step = PHASE_MAGIC;
+
+            uint8_t data[FRAME_HEADER_SIZE + HELLO_SIZE + HELLO_MAX_NAME];
+            size_t size = 0;    /* Read so far */
+            size_t wanted = 2;  /* Needed for the current step */
+
+            hello client;
+            char* name = nullptr; /* malloc(), the client takes it over */
+            clock_sync sync;
+            uint8_t round = 0;
+            uint64_t ping_sent = 0; /* us */
+        };
+
+        void run();
+        /* Moves new sockets over, waits for one if there's nothing to do */
+        void take_new_connections();
+        /* Reads what arrived, false if the handshake failed */
+        bool receive(connection& c);
+        /* Handles the complete data of the current step */
+        bool advance(connection& c);
+        bool answer_hello(connection& c);
+        bool send_ping(connection& c);
+        void finish(connection& c, bool success);
+
+#ifdef _WIN32
+        static DWORD WINAPI thread_method(LPVOID arg);
+        HANDLE m_thread = nullptr;
+#else
+        static void* thread_method(void* arg);
+        pthread_t m_thread{};
+        bool m_started = false;
+#endif
+        io_server* m_server;
+        std::atomic<bool> m_run{false};
+
+        socket_poller m_poller;
+        std::vector<socket_poller::ready_socket> m_ready;
+        std::vector<std::unique_ptr<connection>> m_connections; /* Only touched by the thread */
+
+        std::mutex m_lock;
+        std::condition_variable m_signal;
+        std::deque<tcp_socket> m_pending;
+        std::atomic<size_t> m_count{0}; /* Pending and running handshakes */
+    };
+}
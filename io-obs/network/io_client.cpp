@@ -7,17 +7,37 @@
 
 #include "io_client.hpp"
 #include <util/platform.h>
-#include "util/element/element_button.hpp"
+
+/* Gamepads send triggers as a byte, scaled like local xinput triggers */
+#define REMOTE_TRIGGER_MAX 256.f
 
 namespace network
 {
-    io_client::io_client(char* name, tcp_socket socket, uint8_t id)
+    static int16_t saturate(const int32_t v)
+    {
+        return int16_t(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+    }
+
+    const io_client::handler_table io_client::m_handlers = []
+    {
+        handler_table table = {};
+        table[MSG_BUTTON_DATA] = &io_client::on_button;
+        table[MSG_MOUSE_POS_DATA] = &io_client::on_mouse_pos;
+        table[MSG_GAMEPAD_DATA] = &io_client::on_gamepad;
+        table[MSG_UDP_SESSION] = &io_client::on_udp_session;
+        return table;
+    }();
+
+    io_client::io_client(char* name, tcp_socket socket, uint8_t id, const hello& caps,
+        const clock_sync& sync)
+        : m_caps(caps), m_jitter(sync)
     {
         m_name = name;
         m_socket = socket;
         m_id = id;
 		m_valid = true;
 		m_last_message = os_gettime_ns();
+		m_pads.set_relative(caps.has(CAP_COMPRESSION));
     }
 
     io_client::~io_client()
@@ -56,34 +76,165 @@ namespace network
 		return &m_holder;
     }
 
-    bool io_client::read_event(netlib_byte_buf* buffer, const message msg)
-    {
-		element_data* data = nullptr;
-		uint16_t vc = 0;
-		uint8_t pad_id = 0;
-		auto flag = true;
-
-		if (!netlib_read_uint16(buffer, &vc))
-			flag = false;
-
-        switch (msg)
-        {
-		case MSG_BUTTON_DATA:
-			data = element_data_button::from_buffer(buffer);
-			break;
-		default:;
-        }
-
-        if (!flag || !data)
-        {
-            LOG_(LOG_ERROR, "Couldn't read event for client %s. Error: %s", name(), netlib_get_error());
-        }
-        else
-        {
-            m_holder.add_data(vc, data);
-        }
-            
-		return flag;
+    receive_buffer& io_client::buffer()
+    {
+		return m_buffer;
+    }
+
+    bool io_client::read_frame(const uint8_t* payload, const frame_header& header)
+    {
+		std::lock_guard<std::mutex> lock(m_lock);
+		frame_reader reader(payload, header, m_pads);
+		frame_event event;
+		uint16_t read = 0;
+
+		m_jitter.arrived(header.time, os_gettime_ns() / 1000);
+
+		while (reader.next(event))
+		{
+			if (!has_handler(event.kind))
+				break;
+
+			/* Sessions aren't input, datagrams with the session can come right after it.
+			 * Without timestamps the client's clock is unknown */
+			if (event.kind == MSG_UDP_SESSION || !m_caps.has(CAP_TIMESTAMPS))
+			{
+				apply(event);
+			}
+			else if (!m_jitter.push(event, header.time + event.time))
+			{
+				/* Only happens if the client sends far more than
+				 * it should, then timing doesn't matter anymore */
+				m_jitter.flush([this](const frame_event& e) { apply(e); });
+				m_jitter.push(event, header.time + event.time);
+			}
+			read++;
+		}
+
+		return read == header.count;
+    }
+
+    bool io_client::read_snapshot(const udp_snapshot& snapshot)
+    {
+		std::lock_guard<std::mutex> lock(m_lock);
+		/* Datagrams can arrive out of order, older ones are dropped.
+		 * The difference handles the sequence number wrapping around */
+		if (m_has_snapshot && int32_t(snapshot.sequence - m_sequence) <= 0)
+			return false;
+
+		frame_event event;
+
+		/* Presses and releases that happened between this and the
+		 * last received datagram, so short presses aren't lost */
+		event.kind = MSG_BUTTON_DATA;
+		for (auto i = 0; i < snapshot.history_count; i++)
+		{
+			const auto& change = snapshot.history[i];
+			if (m_has_snapshot && int32_t(change.number - m_last_change) <= 0)
+				continue;
+			event.code = change.code;
+			event.state = change.state;
+			apply(event);
+			m_last_change = change.number;
+		}
+
+		/* The snapshot itself is the current state. A truncated key list
+		 * leaves the keys the history pressed beyond it alone */
+		m_holder.set_pressed_keys(snapshot.keys, snapshot.key_count, !snapshot.keys_truncated);
+
+		for (auto i = 0; i < snapshot.pad_count; i++)
+			apply(snapshot.pads[i]);
+
+		event.kind = MSG_MOUSE_POS_DATA;
+		event.x = snapshot.mouse_x;
+		event.y = snapshot.mouse_y;
+		apply(event);
+
+		m_sequence = snapshot.sequence;
+		m_has_snapshot = true;
+		return true;
+    }
+
+    uint32_t io_client::session() const
+    {
+		return m_session;
+    }
+
+    void io_client::publish()
+    {
+		std::lock_guard<std::mutex> lock(m_lock);
+		const auto now = os_gettime_ns();
+
+		m_jitter.release(now / 1000, [this](const frame_event& e) { apply(e); });
+
+		if (m_has_mouse)
+		{
+			m_holder.set_mouse(m_mouse);
+
+			/* The published movement is only for this update */
+			m_mouse.dx = m_mouse.dy = 0;
+		}
+
+		m_holder.publish();
+    }
+
+    uint64_t io_client::wait_time()
+    {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_jitter.wait_time(os_gettime_ns() / 1000);
+    }
+
+    bool io_client::has_handler(const message kind)
+    {
+		return kind >= 0 && kind < MSG_LAST && m_handlers[kind];
+    }
+
+    bool io_client::apply(const frame_event& event)
+    {
+		if (!has_handler(event.kind))
+			return false;
+
+		(this->*m_handlers[event.kind])(event);
+		return true;
+    }
+
+    void io_client::on_button(const frame_event& event)
+    {
+		m_holder.set_button(event.code, event.state ? STATE_PRESSED : STATE_RELEASED);
+    }
+
+    void io_client::on_mouse_pos(const frame_event& event)
+    {
+		if (m_has_mouse)
+		{
+			m_mouse.dx = saturate(m_mouse.dx + event.x - m_mouse.x);
+			m_mouse.dy = saturate(m_mouse.dy + event.y - m_mouse.y);
+		}
+		m_mouse.x = event.x;
+		m_mouse.y = event.y;
+		m_has_mouse = true;
+    }
+
+    void io_client::on_gamepad(const frame_event& event)
+    {
+		if (event.pad >= m_caps.pads)
+			return;
+
+		/* Clients send pads in xinput's terms */
+		gamepad_data pad;
+		const float sticks[] = {axis_value(event.sticks[0]), axis_value(event.sticks[1]),
+			axis_value(event.sticks[2]), axis_value(event.sticks[3])};
+
+		pad.set_xinput(event.buttons, sticks, event.triggers[0] / REMOTE_TRIGGER_MAX,
+			event.triggers[1] / REMOTE_TRIGGER_MAX);
+		m_holder.set_gamepad(event.pad, pad);
+    }
+
+    void io_client::on_udp_session(const frame_event& event)
+    {
+		/* Datagrams are only accepted if UDP was agreed on */
+		if (m_caps.has(CAP_UDP))
+			m_session = event.session;
     }
 
     bool io_client::valid() const
@@ -7,16 +7,23 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <netlib.h>
 #include "../util/element/element_data_holder.hpp"
+#include "../util/mouse_coalescer.hpp"
 #include "remote_connection.hpp"
+#include "protocol.hpp"
+#include "jitter_buffer.hpp"
+#include "receive_buffer.hpp"
 
 namespace network
 {
 	class io_client
 	{
 	public:
-		io_client(char* name, tcp_socket socket, uint8_t id);
+		io_client(char* name, tcp_socket socket, uint8_t id, const hello& caps, const clock_sync& sync);
 		~io_client();
 
 		tcp_socket socket() const;
@@ -25,16 +32,56 @@ namespace network
 		uint64_t last_message() const;
 		void reset_timeout();
 		element_data_holder* get_data();
-		bool read_event(netlib_byte_buf* buffer, message msg);
+		receive_buffer& buffer();
+		/* Schedules all events of a frame, false if some couldn't be read */
+		bool read_frame(const uint8_t* payload, const frame_header& header);
+		/* Applies a UDP datagram right away, it already is the latest
+		 * state. False if it is older than the last one */
+		bool read_snapshot(const udp_snapshot& snapshot);
+		/* Id the client sends with its datagrams, 0 if it only uses TCP */
+		uint32_t session() const;
+		/* Applies the events that are due and makes them visible to the sources.
+		 * Also called when nothing arrived, so the mouse filter keeps going */
+		void publish();
+		/* Time in us until the next held back event is due */
+		uint64_t wait_time();
 		void mark_invalid();
 		bool valid() const;
 	private:
+		typedef void (io_client::*event_handler)(const frame_event& event);
+		typedef std::array<event_handler, MSG_LAST> handler_table;
+
+		/* Handler for each event kind, nullptr for kinds that aren't events */
+		static const handler_table m_handlers;
+
+		static bool has_handler(message kind);
+		/* False if there's no handler for the kind of the event */
+		bool apply(const frame_event& event);
+		void on_button(const frame_event& event);
+		void on_mouse_pos(const frame_event& event);
+		void on_gamepad(const frame_event& event);
+		void on_udp_session(const frame_event& event);
+
+		/* Frames are read by the client's worker, datagrams
+		 * by the accept thread */
+		std::mutex m_lock;
 		element_data_holder m_holder;
+		hello m_caps;               /* What was agreed on in the handshake */
+		pad_delta m_pads;           /* Gamepad events are relative to these */
+		jitter_buffer m_jitter;     /* Frame events wait here until they're due */
+		receive_buffer m_buffer;
+		std::atomic<uint32_t> m_session{0}; /* Looked up by the accept thread */
+		uint32_t m_sequence = 0;    /* Of the last applied datagram */
+		uint32_t m_last_change = 0; /* Number of the last applied button change */
+		bool m_has_snapshot = false;
+
+		mouse_state m_mouse;        /* dx, dy add up until the next publish() */
+		bool m_has_mouse = false;
 		uint64_t m_last_message;
 		tcp_socket m_socket;
 		uint8_t m_id;
-		/* Set to false if this client should be disconnected on next roundtrip */
-		bool m_valid;
+		/* Set to false if this client should be disconnected by its worker */
+		std::atomic<bool> m_valid;
 		char* m_name;
     };
 }
@@ -11,27 +11,35 @@
 #include <obs-module.h>
 #include <util/platform.h>
 #include <algorithm>
-#include "../util/element/element_button.hpp"
-
-static netlib_socket_set sockets = nullptr;
+#include <thread>
 
 namespace network
 {
 
     io_server::io_server(const uint16_t port)
-        : m_server(nullptr)
+        : m_server(nullptr), m_handshakes(this)
     {
-        sockets = nullptr;
         m_num_clients = 0;
         m_ip.port = port;
     }
 
     io_server::~io_server()
     {
-        /* Smart pointer will delete 
+        /* Handshakes add clients to the workers */
+        m_handshakes.stop();
+
+        /* Workers use the clients until they exit */
+        m_workers.clear();
+
+        /* Smart pointer will delete once no source draws it
          * and destructor will close socket
          */
         m_clients.clear();
+
+        if (m_udp)
+            netlib_udp_close(m_udp);
+        if (m_packet)
+            netlib_free_packet(m_packet);
     }
 
     bool io_server::init()
@@ -50,101 +58,124 @@ namespace network
 				ipaddr >> 24, ipaddr >> 16 & 0xff, ipaddr >> 8 & 0xff, ipaddr & 0xff, m_ip.port);
 
 			m_server = netlib_tcp_open(&m_ip);
-			m_buffer = netlib_alloc_byte_buf(BUFFER_SIZE);
 
-            if (!m_buffer)
-            	LOG_(LOG_ERROR, "netlib_alloc_byte_buf failed; %s", netlib_get_error());
-            
 			if (!m_server)
 			{
 				LOG_(LOG_ERROR, "netlib_tcp_open failed: %s", netlib_get_error());
 				flag = false;
 			}
+			/* Accepting blocks, so the server socket stays level triggered */
+			else if (!m_poller.init() || !m_poller.add(m_server, this, false))
+			{
+				flag = false;
+			}
+			else
+			{
+				/* Clients can still use TCP if this fails */
+				m_udp = netlib_udp_open(m_ip.port);
+				m_packet = netlib_alloc_packet(UDP_MAX_PACKET);
+
+				if (!m_udp || !m_packet || !m_poller.add(m_udp, &m_udp, false))
+				{
+					LOG_(LOG_WARNING, "Couldn't open UDP socket: %s", netlib_get_error());
+					/* Not offered to clients then */
+					if (m_udp)
+						netlib_udp_close(m_udp);
+					m_udp = nullptr;
+				}
+
+				/* Half the cores, the render side needs the rest */
+				auto count = std::thread::hardware_concurrency() / 2;
+				count = UTIL_CLAMP(1u, count, unsigned(MAX_IO_WORKERS));
+
+				for (uint8_t i = 0; i < count; i++)
+				{
+					std::unique_ptr<io_worker> worker(new io_worker(this, i));
+					if (worker->start())
+						m_workers.emplace_back(std::move(worker));
+				}
+
+				flag = !m_workers.empty() && m_handshakes.start();
+			}
 		}
 		return flag;
     }
 
     void io_server::listen(int& numready)
     {
-        if (create_sockets())
-            numready = netlib_check_socket_set(sockets, 100);
+        /* Returns as soon as a socket is readable, the timeout
+         * only bounds how late the thread notices it should exit */
+        numready = m_poller.wait(m_ready, 100);
+    }
+
+    bool io_server::accept_ready() const
+    {
+        return is_ready(this);
+    }
+
+    bool io_server::is_ready(const void* user) const
+    {
+        return std::find_if(m_ready.begin(), m_ready.end(),
+            [user](const socket_poller::ready_socket& r) { return r.user == user; }) != m_ready.end();
     }
 
     tcp_socket io_server::socket() const
     {
         return m_server;
     }
+
+    void io_server::begin_handshake(tcp_socket socket)
+    {
+        m_handshakes.add(socket);
+    }
     
-    void io_server::update_clients()
+    void io_server::receive_datagrams()
     {
-		uint8_t id = 0;
+        if (!is_ready(&m_udp))
+            return;
+
+        udp_snapshot snapshot;
+        int result;
+
+        while ((result = netlib_udp_recv(m_udp, m_packet)) > 0)
+        {
+            if (!read_snapshot(m_packet->data, size_t(m_packet->len), snapshot))
+                continue;
+
+            /* Keeps the client from being removed meanwhile */
+            std::lock_guard<std::mutex> lock(m_clients_lock);
+
+            /* Timeouts are only reset over TCP, so a client whose
+             * datagrams don't get through still disconnects */
+            const auto client = find_session(snapshot.session, m_packet->address);
+            if (client && client->read_snapshot(snapshot))
+                client->publish();
+        }
 
-#ifdef _DEBUG
-		uint64_t last_msg;
-#endif
+        if (result == -1)
+            LOG_(LOG_ERROR, "netlib_udp_recv failed: %s", netlib_get_error());
+    }
+
+    io_client* io_server::find_session(const uint32_t session, const ip_address& sender)
+    {
+        if (!session)
+            return nullptr;
 
         for (const auto& client : m_clients)
         {
-            if (netlib_socket_ready(client->socket()))
-            {
-                /* Receive input data */
-				m_buffer->read_pos = 0; /* Reset buffer */
-
-                if (!netlib_tcp_recv_buf(client->socket(), m_buffer))
-                {
-				    LOG_(LOG_ERROR, "Failed to receive buffer from %s. Closed connection", client->name());
-                    client->mark_invalid();
-                    continue;
-                }
-
-                const auto msg = read_msg_from_buffer(m_buffer);
-				
-                switch (msg)
-                {
-				case MSG_PREVENT_TIMEOUT:
-                    last_msg = client->last_message() / (1000 * 1000);
-#ifdef _DEBUG 
-                    
-					LOG_(LOG_INFO, "Received refresh message from %s after %ums.", client->name(), last_msg);
-#endif
-                    /* Sockets can get stuck after incorrect DC
-                     * So if the message is received at an unusual speed
-                     * just disconnect the client
-                     */
-                    if (client->last_message() < TIMEOUT_NS / 2)
-                    {
-                        LOG_(LOG_INFO, "Recieved refresh message from %s at unusual speed(%ums). Disconnecting.",
-                            client->name(), last_msg);
-                        client->mark_invalid();
-                    }
-                    else
-                    {
-                        client->reset_timeout();
-                    }
-					break;
-				case MSG_MOUSE_POS_DATA:
-				case MSG_BUTTON_DATA:
-					client->reset_timeout();
-					if (!client->read_event(m_buffer, msg))
-					{
-						LOG_(LOG_ERROR, "Failed to receive event data from %s. Closed connection", client->name());
-						/* TODO: Disconnect routine */
-					}
-					break;
-                case MSG_CLIENT_DC:
-                    client->mark_invalid();
-                    break;
-				case MSG_INVALID:
-					break;
-				default: ;
-                }
-            }
-			id++;
+            if (client->session() != session || !client->valid())
+                continue;
+
+            /* Only accept datagrams from where the client connected from */
+            const auto peer = netlib_tcp_get_peer_address(client->socket());
+            return peer && peer->host == sender.host ? client.get() : nullptr;
         }
+        return nullptr;
     }
 
 	void io_server::get_clients(std::vector<const char*>& v)
     {
+		std::lock_guard<std::mutex> lock(m_clients_lock);
 
 		for (const auto& client : m_clients)
 		{
@@ -156,6 +187,7 @@ namespace network
     void io_server::get_clients(obs_property_t* prop, const bool enable_local)
     {
 		obs_property_list_clear(prop);
+		std::lock_guard<std::mutex> lock(m_clients_lock);
 
 		if (enable_local)
 			obs_property_list_add_int(prop, T_LOCAL_SOURCE, 0);
@@ -171,44 +203,40 @@ namespace network
 		return m_clients_changed;
     }
     
-	void io_server::roundtrip()
-	{
-		if (!m_clients.empty())
+    void io_server::remove_client(io_client* client)
+    {
+		std::lock_guard<std::mutex> lock(m_clients_lock);
+		const auto it = std::find_if(m_clients.begin(), m_clients.end(),
+			[client](const std::shared_ptr<io_client>& o) { return o.get() == client; });
+
+		if (it != m_clients.end())
 		{
-			auto old = m_clients.size();
-            m_clients.erase(std::remove_if(
-			    m_clients.begin(), m_clients.end(),
-                [](const std::unique_ptr<io_client>& o)
-                {
-                    if (!o->valid())
-                    {
-						network::server_instance->m_num_clients--;
-						LOG_(LOG_INFO, "%s disconnected. Invalid socket.", o->name());
-						return true;
-                    }
-                    if (o->last_message() > TIMEOUT_NS)
-                    {
-						network::server_instance->m_num_clients--;
-						LOG_(LOG_INFO, "%s disconnected due to timeout.", o->name());
-						return true;
-                    }
-					return false;
-                }
-			), m_clients.end());
-
-			if (old != m_clients.size())
-				m_clients_changed = true;
+			m_clients.erase(it);
+			m_num_clients--;
+			m_clients_changed = true;
 		}
-	}
+    }
 
-    io_client* io_server::get_client(const uint8_t id)
+    std::shared_ptr<io_client> io_server::get_client(const uint8_t id)
     {
+		std::lock_guard<std::mutex> lock(m_clients_lock);
 		if (id >= 0 && id < m_clients.size())
-			return m_clients[id].get();
+			return m_clients[id];
 		return nullptr;
     }
 
-    void io_server::add_client(tcp_socket socket, char* name)
+    hello io_server::capabilities() const
+    {
+        hello h;
+        h.caps = CAP_ALL;
+        if (!m_udp || !m_packet)
+            h.caps &= ~CAP_UDP;
+        h.pads = PAD_COUNT;
+        static_assert(PAD_COUNT <= FRAME_MAX_PADS, "pad_delta can't track all pads");
+        return h;
+    }
+
+    void io_server::add_client(tcp_socket socket, char* name, const hello& client, const clock_sync& sync)
     {
 		fix_name(name);
 
@@ -220,6 +248,7 @@ namespace network
             return;
         }
 
+        std::lock_guard<std::mutex> lock(m_clients_lock);
         if (!unique_name(name))
         {
             LOG_(LOG_INFO, "Disconnected %s: Name already in use", name);
@@ -231,8 +260,15 @@ namespace network
 		LOG_(LOG_INFO, "Received connection from '%s'.", name);
 
 		m_clients_changed = true;
-        m_clients.emplace_back(new io_client(name, socket, m_num_clients));
+        m_clients.emplace_back(new io_client(name, socket, m_num_clients, client, sync));
         m_num_clients++;
+
+        const auto worker = std::min_element(m_workers.begin(), m_workers.end(),
+            [](const std::unique_ptr<io_worker>& a, const std::unique_ptr<io_worker>& b)
+            {
+                return a->client_count() < b->client_count();
+            });
+        (*worker)->add(m_clients.back().get());
     }
 
     bool io_server::unique_name(char* name)
@@ -262,26 +298,4 @@ namespace network
 			name[pos] = '_';
 		}
     }
-
-    bool io_server::create_sockets()
-    {
-        int i;
-        if (sockets)
-            netlib_free_socket_set(sockets);
-
-        sockets = netlib_alloc_socket_set(m_num_clients + 1);
-        if (!sockets)
-        {
-            LOG_(LOG_ERROR, "netlib_alloc_socket_set failed with %i clients.", m_num_clients + 1);
-            network_flag = false;
-            return false;
-        }
-
-        netlib_tcp_add_socket(sockets, m_server);
-
-        for (const auto& client : m_clients)
-            netlib_tcp_add_socket(sockets, client->socket());
-
-        return true;
-    }
 }
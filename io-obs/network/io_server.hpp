@@ -8,8 +8,14 @@
 #pragma once
 
 #include "io_client.hpp"
+#include "io_worker.hpp"
+#include "handshake_worker.hpp"
+#include "socket_poller.hpp"
+#include "protocol.hpp"
 
 #include <netlib.h>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <memory>
 #include <obs-module.h>
@@ -18,12 +24,17 @@
 #include <Windows.h>
 #endif
 
-#define BUFFER_SIZE 5
-
 enum message;
 
 namespace network
 {
+    /**
+     * Accepts connections and receives datagrams on the network thread.
+     * Accepted connections get their handshake on another thread and are
+     * then handed to the io_worker with the fewest clients, which does
+     * everything else for them. The list of
+     * clients is shared by all threads and guarded by m_clients_lock.
+     */
     class io_server
     {
     public:
@@ -32,37 +43,58 @@ namespace network
 
 		bool init();
 		
+        /* Waits until a connection or datagram arrived */
         void listen(int& numready);
+
+        /* True if the last listen() found a connection to accept */
+        bool accept_ready() const;
 		
         tcp_socket socket() const;
+
+        /* Takes over an accepted connection, which is added
+         * once the handshake succeeded */
+        void begin_handshake(tcp_socket socket);
 		
-        void add_client(tcp_socket socket, char* name);
-        
-        void update_clients();
+        /* What this server supports, sent in its hello */
+        hello capabilities() const;
+
+        void add_client(tcp_socket socket, char* name, const hello& client, const clock_sync& sync);
+
+        /* Called by the worker that owned the client, deletes it */
+        void remove_client(io_client* client);
+
+        /* Applies datagrams if the last listen() found any */
+        void receive_datagrams();
 		
         void get_clients(std::vector<const char*>& v);
 		
         void get_clients(obs_property_t* prop, bool enable_local);
 		
         bool clients_changed() const;
-
-		/* Checks clients and removes them
-		 * if necessary
-		 */
-		void roundtrip(); 
 		
-        io_client* get_client(uint8_t id);
+        /* Shared, so the client outlives a disconnect while it's used */
+        std::shared_ptr<io_client> get_client(uint8_t id);
     private:
 		bool unique_name(char* name);
         static void fix_name(char* name);
-		bool create_sockets();
+		/* Has to be called with m_clients_lock held */
+		io_client* find_session(uint32_t session, const ip_address& sender);
+        /* Whether the last listen() reported the socket of user */
+        bool is_ready(const void* user) const;
 	
-		netlib_byte_buf* m_buffer = nullptr; /* Used for temporarily storing sent data */
-		bool m_clients_changed = false; /* Set to true on connection/disconnect and false after get_clients() */
+		std::atomic<bool> m_clients_changed{false}; /* Set to true on connection/disconnect and false after get_clients() */
 		uint8_t m_num_clients;
 		ip_address m_ip{};
 		tcp_socket m_server;
-		std::vector<std::unique_ptr<io_client>> m_clients;
+		udp_socket m_udp = nullptr;     /* Same port as m_server, for clients in UDP mode */
+		udp_packet* m_packet = nullptr;
+		std::vector<std::shared_ptr<io_client>> m_clients;
+		std::mutex m_clients_lock;
+		std::vector<std::unique_ptr<io_worker>> m_workers;
+		handshake_worker m_handshakes;
+
+		socket_poller m_poller;
+		std::vector<socket_poller::ready_socket> m_ready; /* Filled by listen() */
     };
 }
 
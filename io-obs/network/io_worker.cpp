@@ -0,0 +1,275 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "io_worker.hpp"
+#include "io_server.hpp"
+#include "remote_connection.hpp"
+#include <obs-module.h>
+#include <algorithm>
+
+namespace network
+{
+    io_worker::io_worker(io_server* server, const uint8_t id)
+        : m_server(server), m_id(id)
+    {
+    }
+
+    io_worker::~io_worker()
+    {
+        stop();
+    }
+
+    bool io_worker::start()
+    {
+        if (!m_poller.init())
+            return false;
+
+        m_run = true;
+#ifdef _WIN32
+        m_thread = CreateThread(nullptr, 0, static_cast<LPTHREAD_START_ROUTINE>(thread_method),
+            this, 0, nullptr);
+        if (!m_thread)
+#else
+        m_started = pthread_create(&m_thread, nullptr, thread_method, this) == 0;
+        if (!m_started)
+#endif
+        {
+            LOG_(LOG_ERROR, "Creating network worker %i failed.", m_id);
+            m_run = false;
+            return false;
+        }
+        return true;
+    }
+
+    void io_worker::stop()
+    {
+        m_run = false;
+#ifdef _WIN32
+        if (m_thread)
+        {
+            WaitForSingleObject(m_thread, INFINITE);
+            CloseHandle(m_thread);
+            m_thread = nullptr;
+        }
+#else
+        if (m_started)
+        {
+            pthread_join(m_thread, nullptr);
+            m_started = false;
+        }
+#endif
+    }
+
+    void io_worker::add(io_client* client)
+    {
+        std::lock_guard<std::mutex> lock(m_new_lock);
+        m_new_clients.emplace_back(client);
+        ++m_count;
+    }
+
+    size_t io_worker::client_count() const
+    {
+        return m_count;
+    }
+
+#ifdef _WIN32
+    DWORD WINAPI io_worker::thread_method(const LPVOID arg)
+    {
+        static_cast<io_worker*>(arg)->run();
+        return 0x0;
+    }
+#else
+    void* io_worker::thread_method(void* arg)
+    {
+        static_cast<io_worker*>(arg)->run();
+        return nullptr;
+    }
+#endif
+
+    void io_worker::run()
+    {
+        while (m_run)
+        {
+            take_new_clients();
+
+            /* Returns as soon as a client sent something or held back
+             * events are due, otherwise the timeout only bounds how
+             * late sweep() notices timeouts */
+            if (m_poller.wait(m_ready, wait_time()) == -1)
+            {
+                LOG_(LOG_ERROR, "Network worker %i failed to wait for clients.", m_id);
+                break;
+            }
+
+            for (const auto& ready : m_ready)
+            {
+                const auto client = static_cast<io_client*>(ready.user);
+                receive(client, ready.hangup);
+
+                /* Make this batch of events visible to the sources */
+                client->publish();
+            }
+
+            sweep();
+        }
+    }
+
+    uint32_t io_worker::wait_time()
+    {
+        uint64_t us = WORKER_TIMEOUT_MS * 1000;
+        for (const auto client : m_clients)
+            us = std::min(us, client->wait_time());
+
+        /* Rounded up, waking up early would only spin */
+        return uint32_t((us + 999) / 1000);
+    }
+
+    void io_worker::take_new_clients()
+    {
+        std::lock_guard<std::mutex> lock(m_new_lock);
+        for (const auto client : m_new_clients)
+        {
+            /* Data that arrived before this is reported right away.
+             * Clients that can't be added are removed by sweep() */
+            if (!m_poller.add(client->socket(), client, true))
+                client->mark_invalid();
+            m_clients.emplace_back(client);
+        }
+        m_new_clients.clear();
+    }
+
+    void io_worker::sweep()
+    {
+        m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+            [this](io_client* client)
+            {
+                if (!client->valid())
+                {
+                    LOG_(LOG_INFO, "%s disconnected. Invalid socket.", client->name());
+                }
+                else if (client->last_message() > TIMEOUT_NS)
+                {
+                    LOG_(LOG_INFO, "%s disconnected due to timeout.", client->name());
+                }
+                else
+                {
+                    /* Lets the mouse movement of idle clients settle */
+                    client->publish();
+                    return false;
+                }
+
+                m_poller.remove(client->socket());
+                m_server->remove_client(client);
+                --m_count;
+                return true;
+            }), m_clients.end());
+    }
+
+    void io_worker::receive(io_client* client, const bool hangup)
+    {
+        auto& buffer = client->buffer();
+
+        /* Clients are edge triggered, so everything that arrived has to
+         * be read now. Only what's there is read, so a client that
+         * sent half a frame can't block the others */
+        for (;;)
+        {
+            /* Edges can outlive the data that caused them, so nothing
+             * to read doesn't mean the connection was closed. Reading
+             * anyway would block until the client sends again */
+            const auto available = socket_poller::pending(client->socket());
+            if (!available)
+            {
+                /* The close came with the last data, so there's no
+                 * further edge that would let the read report it */
+                if (hangup)
+                    client->mark_invalid();
+                return;
+            }
+
+            const auto wanted = available < buffer.free_space() ? available : buffer.free_space();
+            const auto result = netlib_tcp_recv(client->socket(), buffer.free_data(), int(wanted));
+
+            if (result <= 0)
+            {
+                LOG_(LOG_ERROR, "Failed to receive frame from %s. Closed connection", client->name());
+                client->mark_invalid();
+                return;
+            }
+
+            buffer.produced(size_t(result));
+            if (!handle_frames(client) || !client->valid())
+                return;
+        }
+    }
+
+    bool io_worker::handle_frames(io_client* client)
+    {
+        auto& buffer = client->buffer();
+        frame_header header;
+
+        while (buffer.size() >= FRAME_HEADER_SIZE)
+        {
+            if (!read_frame_header(buffer.data(), header))
+            {
+                LOG_(LOG_ERROR, "%s sent an invalid frame header. Closed connection",
+                    client->name());
+                client->mark_invalid();
+                return false;
+            }
+
+            /* Incomplete, the rest comes with a later read */
+            if (buffer.size() < size_t(FRAME_HEADER_SIZE + header.length))
+                break;
+
+            handle_frame(client, header, buffer.data() + FRAME_HEADER_SIZE);
+            buffer.consume(FRAME_HEADER_SIZE + header.length);
+        }
+
+        buffer.compact();
+        return true;
+    }
+
+    void io_worker::handle_frame(io_client* client, const frame_header& header,
+        const uint8_t* payload)
+    {
+        switch (header.msg)
+        {
+        case MSG_PREVENT_TIMEOUT:
+        {
+            const auto last_msg = uint32_t(client->last_message() / (1000 * 1000));
+#ifdef _DEBUG
+            LOG_(LOG_INFO, "Received refresh message from %s after %ums.", client->name(), last_msg);
+#endif
+            /* Sockets can get stuck after incorrect DC
+             * So if the message is received at an unusual speed
+             * just disconnect the client
+             */
+            if (client->last_message() < TIMEOUT_NS / 2)
+            {
+                LOG_(LOG_INFO, "Recieved refresh message from %s at unusual speed(%ums). Disconnecting.",
+                    client->name(), last_msg);
+                client->mark_invalid();
+            }
+            else
+            {
+                client->reset_timeout();
+            }
+            break;
+        }
+        case MSG_EVENT_FRAME:
+            client->reset_timeout();
+            if (!client->read_frame(payload, header))
+                LOG_(LOG_ERROR, "Frame from %s contained invalid events.", client->name());
+            break;
+        case MSG_CLIENT_DC:
+            client->mark_invalid();
+            break;
+        default: ;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "socket_poller.hpp"
+#include "protocol.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Upper limit for the worker threads the server starts */
+#define MAX_IO_WORKERS 4
+/* Longest a worker waits for its clients */
+#define WORKER_TIMEOUT_MS 100
+
+namespace network
+{
+    class io_client;
+    class io_server;
+
+    /**
+     * Thread that owns a share of the remote clients. It waits for their
+     * sockets, reads and applies their frames, publishes their state and
+     * disconnects them on errors or timeouts. Clients of other workers
+     * never wait for it, so one slow client only holds up its own worker.
+     */
+    class io_worker
+    {
+    public:
+        io_worker(io_server* server, uint8_t id);
+        ~io_worker();
+
+        bool start();
+        /* Waits for the thread to exit */
+        void stop();
+
+        /* Called by the accept thread, the worker takes
+         * the client over with its next wakeup */
+        void add(io_client* client);
+
+        /* Clients this worker owns, used to pick the least busy one */
+        size_t client_count() const;
+    private:
+        void run();
+        /* Until the next client has held back events due, in ms */
+        uint32_t wait_time();
+        void take_new_clients();
+        /* Publishes all clients and disconnects invalid ones */
+        void sweep();
+
+        /* Reads everything that arrived and handles all complete frames,
+         * hangup: The client closed the connection after that */
+        void receive(io_client* client, bool hangup);
+        /* False if the client sent something that isn't a frame */
+        bool handle_frames(io_client* client);
+        void handle_frame(io_client* client, const frame_header& header, const uint8_t* payload);
+
+#ifdef _WIN32
+        static DWORD WINAPI thread_method(LPVOID arg);
+        HANDLE m_thread = nullptr;
+#else
+        static void* thread_method(void* arg);
+        pthread_t m_thread{};
+        bool m_started = false;
+#endif
+        io_server* m_server;
+        uint8_t m_id;
+        std::atomic<bool> m_run{false};
+
+        socket_poller m_poller;
+        std::vector<socket_poller::ready_socket> m_ready;
+        std::vector<io_client*> m_clients;  /* Only touched by the worker */
+
+        std::mutex m_new_lock;
+        std::vector<io_client*> m_new_clients;
+        std::atomic<size_t> m_count{0};
+    };
+}
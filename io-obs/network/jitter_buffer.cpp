@@ -0,0 +1,76 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "jitter_buffer.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace network
+{
+    jitter_buffer::jitter_buffer(const clock_sync& sync)
+        : m_offset(sync.offset), m_transit(int64_t(sync.rtt / 2))
+    {
+    }
+
+    void jitter_buffer::arrived(const uint64_t client_us, const uint64_t now_us)
+    {
+        const auto transit = int64_t(now_us) - (int64_t(client_us) - m_offset);
+
+        /* Smoothed difference between the transits of consecutive frames */
+        if (m_has_transit)
+            m_jitter += (double(std::llabs(transit - m_last_transit)) - m_jitter) / 16.;
+        m_last_transit = transit;
+        m_has_transit = true;
+
+        /* Nothing arrives faster than the fastest transit, so the
+         * offset was a bit off or the clocks drifted */
+        m_transit = std::min(m_transit, transit);
+
+        if (!m_window_start)
+            m_window_start = now_us;
+        m_window_min = std::min(m_window_min, transit);
+
+        /* Everything took longer for a whole window, which
+         * happens if the clocks drift the other way */
+        if (now_us - m_window_start >= JITTER_WINDOW_US)
+        {
+            m_transit = m_window_min;
+            m_window_min = INT64_MAX;
+            m_window_start = now_us;
+        }
+    }
+
+    bool jitter_buffer::push(const frame_event& event, const uint64_t client_us)
+    {
+        const auto next = (m_write + 1) & (JITTER_BUFFER_SIZE - 1);
+        if (next == m_read)
+            return false;
+
+        auto due = int64_t(client_us) - m_offset + m_transit + int64_t(delay());
+        due = std::max(due, m_last_due);
+
+        m_events[m_write] = {due, event};
+        m_write = next;
+        m_last_due = due;
+        return true;
+    }
+
+    uint64_t jitter_buffer::wait_time(const uint64_t now_us) const
+    {
+        if (m_read == m_write)
+            return UINT64_MAX;
+
+        const auto due = m_events[m_read].due;
+        return due > int64_t(now_us) ? uint64_t(due - int64_t(now_us)) : 0;
+    }
+
+    uint64_t jitter_buffer::delay() const
+    {
+        const auto delay = uint64_t(m_jitter * JITTER_FACTOR);
+        return std::min<uint64_t>(std::max<uint64_t>(delay, JITTER_MIN_US), JITTER_MAX_US);
+    }
+}
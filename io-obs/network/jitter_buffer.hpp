@@ -0,0 +1,98 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "protocol.hpp"
+
+/* Has to be a power of two */
+#define JITTER_BUFFER_SIZE  512
+/* Bounds of the delay added on top of the fastest transit seen */
+#define JITTER_MIN_US       1000
+#define JITTER_MAX_US       30000
+/* The delay is this many times the measured jitter */
+#define JITTER_FACTOR       3
+/* The fastest transit is measured again this often, so the
+ * schedule follows clocks that drift apart */
+#define JITTER_WINDOW_US    (2 * 1000 * 1000)
+
+namespace network
+{
+    /* Result of the clock pings after the handshake */
+    struct clock_sync
+    {
+        int64_t offset = 0; /* Client clock minus server clock in us */
+        uint64_t rtt = 0;   /* Round trip of the ping the offset is from */
+    };
+
+    /**
+     * Holds back events of one client so they're applied with the same
+     * spacing the client saw them with, instead of whenever the network
+     * delivered them. An event is due at the time the client saw it
+     * (in server time) plus the fastest transit seen recently plus a
+     * delay that covers most of the measured jitter. Events that arrive
+     * after that are applied right away.
+     *
+     * Not thread safe, the owning io_client locks around it.
+     */
+    class jitter_buffer
+    {
+    public:
+        explicit jitter_buffer(const clock_sync& sync);
+
+        /* Called for every frame, client_us is its base time */
+        void arrived(uint64_t client_us, uint64_t now_us);
+
+        /* Schedules an event the client saw at client_us,
+         * false if the buffer is full */
+        bool push(const frame_event& event, uint64_t client_us);
+
+        /* Calls f with every event that's due, oldest first */
+        template<class F>
+        void release(const uint64_t now_us, F f)
+        {
+            while (m_read != m_write && m_events[m_read].due <= int64_t(now_us))
+            {
+                f(m_events[m_read].event);
+                m_read = (m_read + 1) & (JITTER_BUFFER_SIZE - 1);
+            }
+        }
+
+        /* Calls f with every event, regardless of when it's due */
+        template<class F>
+        void flush(F f)
+        {
+            release(uint64_t(INT64_MAX), f);
+        }
+
+        /* Time until the next event is due, UINT64_MAX if there is none */
+        uint64_t wait_time(uint64_t now_us) const;
+
+        /* Current delay on top of the fastest transit */
+        uint64_t delay() const;
+    private:
+        struct entry
+        {
+            int64_t due;    /* Server time in us */
+            frame_event event;
+        };
+
+        std::array<entry, JITTER_BUFFER_SIZE> m_events;
+        uint32_t m_read = 0, m_write = 0;
+        int64_t m_last_due = 0;     /* Events never overtake each other */
+
+        int64_t m_offset;
+        int64_t m_transit;          /* Fastest transit, until a window proves otherwise */
+        int64_t m_window_min = INT64_MAX;
+        uint64_t m_window_start = 0;
+        int64_t m_last_transit = 0;
+        bool m_has_transit = false;
+        double m_jitter = 0.;       /* RFC 3550 interarrival jitter in us */
+    };
+}
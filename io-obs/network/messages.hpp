@@ -5,6 +5,8 @@
  * github.com/univrsal/input-overlay
  */
 
+#pragma once
+
 enum message
 {
 	MSG_READ_ERROR = -2,
@@ -17,5 +19,10 @@ enum message
 	MSG_MOUSE_POS_DATA,
     MSG_GAMEPAD_DATA,
     MSG_CLIENT_DC,
+	MSG_EVENT_FRAME, /* See protocol.hpp */
+	MSG_UDP_SESSION, /* Only used as event kind, see protocol.hpp */
+	MSG_TIME_SYNC, /* Clock ping and its answer, see protocol.hpp */
+	MSG_HELLO, /* First frame of both ends */
+	MSG_VERSION_UNSUPPORTED, /* Answer to a hello the server can't speak */
 	MSG_LAST
 };
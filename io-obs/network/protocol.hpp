@@ -0,0 +1,772 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "messages.hpp"
+
+/**
+ * Wire format between io-client and the remote connection server.
+ * Both ends start with a hello, then the client answers SYNC_ROUNDS
+ * clock pings and from then on only sends frames:
+ *
+ *   header   magic "IO", version (u8), message (u8), event count (u16),
+ *            payload length (u16), base time in us (u64)
+ *   payload  event count events, each made of
+ *            kind (u8, a message id), time since the base time in us (u32),
+ *            data depending on the kind (see *_EVENT_SIZE)
+ *
+ * Gamepad events are deltas: Pad (u8), a mask of the fields that changed
+ * (see pad_field), then one varint per changed field. Buttons are xor'd
+ * with the last state, sticks (quantized to i16) and triggers are
+ * zig-zag encoded differences. Both ends keep the last state of each pad
+ * in a pad_delta, over TCP nothing gets lost so it's the same on both.
+ *
+ * Numbers are little endian. Frames carrying input have the message
+ * MSG_EVENT_FRAME, MSG_PREVENT_TIMEOUT and MSG_CLIENT_DC are sent as
+ * frames without events. The length lets the server read a whole frame
+ * with two reads.
+ *
+ * In UDP mode the TCP connection only carries the name, keep-alives and
+ * one MSG_UDP_SESSION event, which tells the server the session id of the
+ * client's datagrams. Each datagram holds the complete input state, so a
+ * lost one is made up for by the next instead of holding it back:
+ *
+ *   header   magic "IU", version (u8), reserved (u8), session (u32),
+ *            sequence (u32), client time in us (u64)
+ *   mouse    x, y (i16)
+ *   keys     count (u8), pressed key codes (u16). If more keys are pressed
+ *            than fit, the count has UDP_KEYS_TRUNCATED set
+ *   pads     count (u8), pads encoded like MSG_GAMEPAD_DATA events,
+ *            relative to a released pad so each datagram stands alone
+ *   history  count (u8), the last button changes, oldest first:
+ *            number (u32), key code (u16), state (u8)
+ *
+ * The history repeats the last UDP_HISTORY button changes, so presses
+ * that started and ended between two lost datagrams still arrive. Keys
+ * that don't fit into a truncated list only arrive through the history,
+ * the server doesn't release unlisted keys then.
+ *
+ * The hello is a frame without events, sent by the client first:
+ *
+ *   payload  capabilities (u32, see capability), pads it can send (u8),
+ *            name (the rest, not terminated)
+ *
+ * The server answers with a frame of the same layout but without name.
+ * Its version is the one both ends use, the lower of the two, its
+ * capabilities and pad count are what both ends support. If the server
+ * can't speak the client's version, the answer's message is
+ * MSG_VERSION_UNSUPPORTED instead of MSG_HELLO and the connection is
+ * closed. The header keeps its layout in every version, so that answer
+ * can always be read. Clients from before the hello sent their name
+ * with a big endian length, which never starts with the magic.
+ *
+ * Clock pings are a single MSG_TIME_SYNC byte from the server, which the
+ * client answers right away with a MSG_TIME_SYNC frame carrying its
+ * clock. The server then knows the client's clock relative to its own
+ * (NTP style, assuming both directions take equally long) and can replay
+ * events with the spacing the client saw them with.
+ *
+ * Shared by io-obs and io-client, so this stays header only.
+ */
+
+#define FRAME_MAGIC         "IO"
+#define FRAME_VERSION       4
+#define FRAME_MIN_VERSION   4   /* Oldest version that is still understood */
+#define FRAME_HEADER_SIZE   16
+#define FRAME_MAX_PAYLOAD   4096
+
+#define HELLO_SIZE          5   /* Capabilities (u32), pads (u8) */
+#define HELLO_MAX_NAME      63
+
+#define SYNC_ROUNDS         8   /* Clock pings, the one with the shortest round trip is used */
+#define HANDSHAKE_TIMEOUT_MS 500 /* For each answer during the handshake, checked by the client */
+#define HANDSHAKE_DEADLINE_MS 2000 /* For the whole handshake, checked by the server */
+
+#define EVENT_HEADER_SIZE       5
+#define BUTTON_EVENT_SIZE       3   /* Key code (u16), state (u8) */
+#define MOUSE_POS_EVENT_SIZE    4   /* x, y (i16) */
+#define GAMEPAD_EVENT_MAX_SIZE  21  /* Pad (u8), mask (u8), buttons (3), sticks (4x 3), triggers (2x 2) */
+#define UDP_SESSION_EVENT_SIZE  4   /* Session id (u32) */
+
+#define UDP_MAGIC           "IU"
+#define UDP_VERSION         2
+#define UDP_HEADER_SIZE     20
+#define UDP_MAX_KEYS        32
+#define UDP_KEYS_TRUNCATED  0x80 /* Flag in the key count */
+#define UDP_MAX_PADS        4
+#define UDP_HISTORY         8
+#define UDP_CHANGE_SIZE     7
+#define FRAME_MAX_PADS      16  /* Pads a pad_delta keeps track of */
+
+#define UDP_MAX_PACKET      (UDP_HEADER_SIZE + 4 + 1 + UDP_MAX_KEYS * 2 + 1 + \
+                            UDP_MAX_PADS * GAMEPAD_EVENT_MAX_SIZE + 1 + UDP_HISTORY * UDP_CHANGE_SIZE)
+
+namespace network
+{
+    struct frame_header
+    {
+        uint8_t version;
+        message msg;
+        uint16_t count;     /* Events in the payload */
+        uint16_t length;    /* Payload size in bytes */
+        uint64_t time;      /* Client clock in us */
+    };
+
+    /* One event of a frame, only the fields of its kind are used */
+    struct frame_event
+    {
+        message kind;
+        uint32_t time;              /* us since frame_header::time */
+
+        uint16_t code;              /* MSG_BUTTON_DATA */
+        uint8_t state;
+
+        int16_t x, y;               /* MSG_MOUSE_POS_DATA */
+
+        uint8_t pad;                /* MSG_GAMEPAD_DATA */
+        uint16_t buttons;
+        int16_t sticks[4];          /* Left x, y, right x, y, see quantize_axis() */
+        uint8_t triggers[2];
+
+        uint32_t session;           /* MSG_UDP_SESSION */
+    };
+
+    /* One key or mouse button change in a datagram's history */
+    struct button_change
+    {
+        uint32_t number;    /* Counts up with every change */
+        uint16_t code;
+        uint8_t state;
+    };
+
+    /* Contents of one UDP datagram */
+    struct udp_snapshot
+    {
+        uint32_t session;
+        uint32_t sequence;
+        uint64_t time;
+
+        int16_t mouse_x, mouse_y;
+
+        uint8_t key_count;
+        bool keys_truncated;    /* More keys are pressed than keys holds */
+        uint16_t keys[UDP_MAX_KEYS];
+
+        uint8_t pad_count;
+        frame_event pads[UDP_MAX_PADS];
+
+        uint8_t history_count;
+        button_change history[UDP_HISTORY];
+    };
+
+    /* Fields of a gamepad event that differ from the last state */
+    enum pad_field
+    {
+        PAD_FIELD_BUTTONS = 1 << 0,
+        PAD_FIELD_STICK_LX = 1 << 1, /* Followed by the other three sticks */
+        PAD_FIELD_TRIGGER_L = 1 << 5,
+        PAD_FIELD_TRIGGER_R = 1 << 6,
+        PAD_FIELD_ALL = 0x7f
+    };
+
+    /**
+     * Optional parts of the protocol. Each end announces what it
+     * supports in its hello, only what both support is used
+     */
+    enum capability : uint32_t
+    {
+        CAP_BATCHING = 1 << 0,      /* More than one event per frame */
+        CAP_COMPRESSION = 1 << 1,   /* Gamepad events relative to the last state of their pad,
+                                     * otherwise to a released pad */
+        CAP_UDP = 1 << 2,           /* State snapshots over UDP */
+        CAP_TIMESTAMPS = 1 << 3,    /* Clock pings, events are replayed with the client's timing */
+        CAP_ALL = CAP_BATCHING | CAP_COMPRESSION | CAP_UDP | CAP_TIMESTAMPS
+    };
+
+    /* Contents of a hello, the name is kept separately */
+    struct hello
+    {
+        uint8_t version = FRAME_VERSION;
+        uint32_t caps = 0;
+        uint8_t pads = 0;
+
+        bool has(const capability cap) const { return (caps & cap) == uint32_t(cap); }
+    };
+
+    /* Largest size of the data of an event, gamepad events are shorter
+     * if fewer fields changed */
+    inline size_t event_size(const message kind)
+    {
+        switch (kind)
+        {
+        case MSG_BUTTON_DATA:
+            return BUTTON_EVENT_SIZE;
+        case MSG_MOUSE_POS_DATA:
+            return MOUSE_POS_EVENT_SIZE;
+        case MSG_GAMEPAD_DATA:
+            return GAMEPAD_EVENT_MAX_SIZE;
+        case MSG_UDP_SESSION:
+            return UDP_SESSION_EVENT_SIZE;
+        default:
+            return 0;
+        }
+    }
+
+    /* Little endian helpers */
+
+    inline void put_u16(uint8_t* p, const uint16_t v)
+    {
+        p[0] = uint8_t(v);
+        p[1] = uint8_t(v >> 8);
+    }
+
+    inline void put_u32(uint8_t* p, const uint32_t v)
+    {
+        put_u16(p, uint16_t(v));
+        put_u16(p + 2, uint16_t(v >> 16));
+    }
+
+    inline void put_u64(uint8_t* p, const uint64_t v)
+    {
+        put_u32(p, uint32_t(v));
+        put_u32(p + 4, uint32_t(v >> 32));
+    }
+
+    inline uint16_t get_u16(const uint8_t* p)
+    {
+        return uint16_t(p[0] | p[1] << 8);
+    }
+
+    inline uint32_t get_u32(const uint8_t* p)
+    {
+        return get_u16(p) | uint32_t(get_u16(p + 2)) << 16;
+    }
+
+    inline uint64_t get_u64(const uint8_t* p)
+    {
+        return get_u32(p) | uint64_t(get_u32(p + 4)) << 32;
+    }
+
+    inline void put_f32(uint8_t* p, const float v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        put_u32(p, bits);
+    }
+
+    inline float get_f32(const uint8_t* p)
+    {
+        const auto bits = get_u32(p);
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    /* Stick axes are sent as [-32767, 32767] */
+    inline int16_t quantize_axis(const float v)
+    {
+        if (v >= 1.f)
+            return INT16_MAX;
+        if (v <= -1.f)
+            return -INT16_MAX;
+        return int16_t(v * INT16_MAX + (v < 0.f ? -.5f : .5f));
+    }
+
+    inline float axis_value(const int16_t v)
+    {
+        return float(v) / INT16_MAX;
+    }
+
+    /* Varints: Seven bits per byte, lowest first, the top bit
+     * is set if another byte follows */
+
+    inline uint8_t* put_varint(uint8_t* p, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            *p++ = uint8_t(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = uint8_t(v);
+        return p;
+    }
+
+    /* nullptr if the varint doesn't end before end or is too long */
+    inline const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint32_t& v)
+    {
+        v = 0;
+        for (auto shift = 0; p < end && shift < 32; shift += 7)
+        {
+            const auto byte = *p++;
+            v |= uint32_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return p;
+        }
+        return nullptr;
+    }
+
+    /* Small differences in either direction give small varints */
+    inline uint32_t zigzag(const int32_t v)
+    {
+        return uint32_t(v) << 1 ^ uint32_t(v >> 31);
+    }
+
+    inline int32_t unzigzag(const uint32_t v)
+    {
+        return int32_t(v >> 1) ^ -int32_t(v & 1);
+    }
+
+    /* Writes the fields of e that differ from ref, returns the size */
+    inline size_t write_gamepad(uint8_t* out, const frame_event& e, const frame_event& ref)
+    {
+        uint8_t mask = 0;
+        auto p = out + 2;
+
+        if (e.buttons != ref.buttons)
+        {
+            mask |= PAD_FIELD_BUTTONS;
+            p = put_varint(p, uint32_t(e.buttons ^ ref.buttons));
+        }
+
+        for (auto i = 0; i < 4; i++)
+        {
+            if (e.sticks[i] != ref.sticks[i])
+            {
+                mask |= PAD_FIELD_STICK_LX << i;
+                p = put_varint(p, zigzag(int32_t(e.sticks[i]) - ref.sticks[i]));
+            }
+        }
+
+        for (auto i = 0; i < 2; i++)
+        {
+            if (e.triggers[i] != ref.triggers[i])
+            {
+                mask |= PAD_FIELD_TRIGGER_L << i;
+                p = put_varint(p, zigzag(int32_t(e.triggers[i]) - ref.triggers[i]));
+            }
+        }
+
+        out[0] = e.pad;
+        out[1] = mask;
+        return size_t(p - out);
+    }
+
+    /* Applies the fields in data to ref and stores the result in e.
+     * Returns the bytes read or 0 if the data is cut off or invalid */
+    inline size_t read_gamepad(const uint8_t* data, const size_t length, const frame_event& ref,
+        frame_event& e)
+    {
+        if (length < 2 || data[1] & ~PAD_FIELD_ALL)
+            return 0;
+
+        const auto end = data + length;
+        const auto mask = data[1];
+        auto p = data + 2;
+        uint32_t v;
+
+        e.kind = MSG_GAMEPAD_DATA;
+        e.pad = data[0];
+        e.buttons = ref.buttons;
+        memcpy(e.sticks, ref.sticks, sizeof(e.sticks));
+        memcpy(e.triggers, ref.triggers, sizeof(e.triggers));
+
+        if (mask & PAD_FIELD_BUTTONS)
+        {
+            if (!(p = get_varint(p, end, v)) || v > UINT16_MAX)
+                return 0;
+            e.buttons ^= uint16_t(v);
+        }
+
+        for (auto i = 0; i < 4; i++)
+        {
+            if (!(mask & PAD_FIELD_STICK_LX << i))
+                continue;
+            if (!(p = get_varint(p, end, v)))
+                return 0;
+            const auto axis = int32_t(ref.sticks[i]) + unzigzag(v);
+            if (axis < -INT16_MAX || axis > INT16_MAX)
+                return 0;
+            e.sticks[i] = int16_t(axis);
+        }
+
+        for (auto i = 0; i < 2; i++)
+        {
+            if (!(mask & PAD_FIELD_TRIGGER_L << i))
+                continue;
+            if (!(p = get_varint(p, end, v)))
+                return 0;
+            const auto trigger = int32_t(ref.triggers[i]) + unzigzag(v);
+            if (trigger < 0 || trigger > UINT8_MAX)
+                return 0;
+            e.triggers[i] = uint8_t(trigger);
+        }
+        return size_t(p - data);
+    }
+
+    /**
+     * Last state of each pad of one connection, gamepad
+     * events are encoded relative to it
+     */
+    class pad_delta
+    {
+    public:
+        pad_delta() { reset(); }
+
+        void reset()
+        {
+            for (auto& pad : m_pads)
+                pad = {};
+        }
+
+        /* Without CAP_COMPRESSION events are written and read
+         * relative to a released pad, so each one stands alone */
+        void set_relative(const bool relative) { m_relative = relative; }
+
+        /* Returns the size, 0 if the pad is out of range */
+        size_t write(uint8_t* out, const frame_event& e)
+        {
+            if (e.pad >= FRAME_MAX_PADS)
+                return 0;
+            const auto size = write_gamepad(out, e, reference(e.pad));
+            m_pads[e.pad] = e;
+            return size;
+        }
+
+        /* Returns the bytes read, 0 if the event is invalid */
+        size_t read(const uint8_t* data, const size_t length, frame_event& e)
+        {
+            if (!length || data[0] >= FRAME_MAX_PADS)
+                return 0;
+            const auto size = read_gamepad(data, length, reference(data[0]), e);
+            if (size)
+                m_pads[e.pad] = e;
+            return size;
+        }
+
+        /* False if e carries the same state as the last one of its pad */
+        bool changed(const frame_event& e) const
+        {
+            if (e.pad >= FRAME_MAX_PADS)
+                return true;
+            const auto& last = m_pads[e.pad];
+            return e.buttons != last.buttons || memcmp(e.sticks, last.sticks, sizeof(e.sticks))
+                || memcmp(e.triggers, last.triggers, sizeof(e.triggers));
+        }
+    private:
+        const frame_event& reference(const uint8_t pad) const
+        {
+            static const frame_event released = {};
+            return m_relative ? m_pads[pad] : released;
+        }
+
+        frame_event m_pads[FRAME_MAX_PADS];
+        bool m_relative = true;
+    };
+
+    inline void write_frame_header(uint8_t* out, const message msg, const uint16_t count,
+        const uint16_t length, const uint64_t time)
+    {
+        memcpy(out, FRAME_MAGIC, 2);
+        out[2] = FRAME_VERSION;
+        out[3] = uint8_t(msg);
+        put_u16(out + 4, count);
+        put_u16(out + 6, length);
+        put_u64(out + 8, time);
+    }
+
+    /* Accepts every version, for hellos */
+    inline bool read_any_frame_header(const uint8_t* data, frame_header& h)
+    {
+        if (memcmp(data, FRAME_MAGIC, 2) != 0)
+            return false;
+
+        h.version = data[2];
+        h.msg = message(data[3]);
+        h.count = get_u16(data + 4);
+        h.length = get_u16(data + 6);
+        h.time = get_u64(data + 8);
+        return h.length <= FRAME_MAX_PAYLOAD;
+    }
+
+    /* False if data doesn't start with a header of a version we understand */
+    inline bool read_frame_header(const uint8_t* data, frame_header& h)
+    {
+        return read_any_frame_header(data, h) && h.version >= FRAME_MIN_VERSION
+            && h.version <= FRAME_VERSION;
+    }
+
+    /* Writes a whole hello frame, name can be nullptr. Returns its size,
+     * out needs room for FRAME_HEADER_SIZE + HELLO_SIZE + HELLO_MAX_NAME */
+    inline size_t write_hello(uint8_t* out, const message msg, const hello& h, const char* name,
+        const uint64_t time)
+    {
+        auto length = name ? strlen(name) : 0;
+        if (length > HELLO_MAX_NAME)
+            length = HELLO_MAX_NAME;
+
+        write_frame_header(out, msg, 0, uint16_t(HELLO_SIZE + length), time);
+        out[2] = h.version;
+        put_u32(out + FRAME_HEADER_SIZE, h.caps);
+        out[FRAME_HEADER_SIZE + 4] = h.pads;
+        if (length)
+            memcpy(out + FRAME_HEADER_SIZE + HELLO_SIZE, name, length);
+        return FRAME_HEADER_SIZE + HELLO_SIZE + length;
+    }
+
+    /* name receives the terminated name and needs room for HELLO_MAX_NAME + 1 */
+    inline bool read_hello(const uint8_t* payload, const frame_header& header, hello& h, char* name)
+    {
+        if (header.length < HELLO_SIZE || header.length > HELLO_SIZE + HELLO_MAX_NAME)
+            return false;
+
+        h.version = header.version;
+        h.caps = get_u32(payload);
+        h.pads = payload[4];
+
+        const auto length = header.length - HELLO_SIZE;
+        memcpy(name, payload + HELLO_SIZE, length);
+        name[length] = '\0';
+        return true;
+    }
+
+    /**
+     * Builds one frame in place, so sending it is a single write
+     */
+    class frame_writer
+    {
+    public:
+        void begin(const message msg, const uint64_t time)
+        {
+            m_msg = msg;
+            m_time = time;
+            m_count = 0;
+            m_size = FRAME_HEADER_SIZE;
+        }
+
+        /* False if the event doesn't fit anymore. Gamepad events
+         * without changes are skipped */
+        bool add(const frame_event& e)
+        {
+            if (e.kind == MSG_GAMEPAD_DATA && !m_pads.changed(e))
+                return true;
+
+            auto size = event_size(e.kind);
+            if (!size || m_size + EVENT_HEADER_SIZE + size > sizeof(m_data)
+                || m_count >= m_max_events)
+                return false;
+
+            auto p = m_data + m_size;
+            p[0] = uint8_t(e.kind);
+            put_u32(p + 1, e.time);
+            p += EVENT_HEADER_SIZE;
+
+            switch (e.kind)
+            {
+            case MSG_BUTTON_DATA:
+                put_u16(p, e.code);
+                p[2] = e.state;
+                break;
+            case MSG_MOUSE_POS_DATA:
+                put_u16(p, uint16_t(e.x));
+                put_u16(p + 2, uint16_t(e.y));
+                break;
+            case MSG_GAMEPAD_DATA:
+                size = m_pads.write(p, e);
+                if (!size)
+                    return false;
+                break;
+            case MSG_UDP_SESSION:
+                put_u32(p, e.session);
+                break;
+            default: ;
+            }
+
+            m_size += EVENT_HEADER_SIZE + size;
+            m_count++;
+            return true;
+        }
+
+        /* Fills in the header, the frame is data()[0, size()) */
+        void finish()
+        {
+            write_frame_header(m_data, m_msg, m_count, uint16_t(m_size - FRAME_HEADER_SIZE), m_time);
+        }
+
+        pad_delta& pads() { return m_pads; }
+
+        /* Without CAP_BATCHING frames are full after one event */
+        void set_max_events(const uint16_t max) { m_max_events = max; }
+
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        size_t free_space() const { return sizeof(m_data) - m_size; }
+        uint16_t count() const { return m_count; }
+        uint64_t time() const { return m_time; }
+    private:
+        pad_delta m_pads;   /* Last sent pad states, kept across frames */
+        uint8_t m_data[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD] = {};
+        size_t m_size = FRAME_HEADER_SIZE;
+        uint16_t m_count = 0;
+        uint16_t m_max_events = UINT16_MAX;
+        message m_msg = MSG_EVENT_FRAME;
+        uint64_t m_time = 0;
+    };
+
+    /**
+     * Walks the events of a received payload. pads holds the
+     * pad states of the connection the payload came from
+     */
+    class frame_reader
+    {
+    public:
+        frame_reader(const uint8_t* payload, const frame_header& header, pad_delta& pads)
+            : m_data(payload), m_length(header.length), m_left(header.count), m_pads(pads)
+        {
+        }
+
+        /* False once all events are read or if the payload is cut off */
+        bool next(frame_event& e)
+        {
+            if (!m_left || m_pos + EVENT_HEADER_SIZE > m_length)
+                return false;
+
+            auto p = m_data + m_pos;
+            e.kind = message(p[0]);
+            e.time = get_u32(p + 1);
+            const auto left = m_length - m_pos - EVENT_HEADER_SIZE;
+            auto size = event_size(e.kind);
+
+            /* Unknown kinds have no size, so the rest can't be read */
+            if (!size || (e.kind != MSG_GAMEPAD_DATA && size > left))
+                return false;
+            p += EVENT_HEADER_SIZE;
+
+            switch (e.kind)
+            {
+            case MSG_BUTTON_DATA:
+                e.code = get_u16(p);
+                e.state = p[2];
+                break;
+            case MSG_MOUSE_POS_DATA:
+                e.x = int16_t(get_u16(p));
+                e.y = int16_t(get_u16(p + 2));
+                break;
+            case MSG_GAMEPAD_DATA:
+                size = m_pads.read(p, left, e);
+                if (!size)
+                    return false;
+                break;
+            case MSG_UDP_SESSION:
+                e.session = get_u32(p);
+                break;
+            default: ;
+            }
+
+            m_pos += EVENT_HEADER_SIZE + size;
+            m_left--;
+            return true;
+        }
+    private:
+        const uint8_t* m_data;
+        size_t m_length;
+        size_t m_pos = 0;
+        uint16_t m_left;
+        pad_delta& m_pads;
+    };
+
+    /* Returns the datagram size, out has to hold UDP_MAX_PACKET bytes */
+    inline size_t write_snapshot(const udp_snapshot& s, uint8_t* out)
+    {
+        auto p = out;
+        memcpy(p, UDP_MAGIC, 2);
+        p[2] = UDP_VERSION;
+        p[3] = 0;
+        put_u32(p + 4, s.session);
+        put_u32(p + 8, s.sequence);
+        put_u64(p + 12, s.time);
+        p += UDP_HEADER_SIZE;
+
+        put_u16(p, uint16_t(s.mouse_x));
+        put_u16(p + 2, uint16_t(s.mouse_y));
+        p += 4;
+
+        const auto keys = s.key_count < UDP_MAX_KEYS ? s.key_count : UDP_MAX_KEYS;
+        const auto truncated = s.keys_truncated || s.key_count > UDP_MAX_KEYS;
+        *p++ = uint8_t(keys | (truncated ? UDP_KEYS_TRUNCATED : 0));
+        for (auto i = 0; i < keys; i++, p += 2)
+            put_u16(p, s.keys[i]);
+
+        const frame_event released = {};
+        const auto pads = s.pad_count < UDP_MAX_PADS ? s.pad_count : UDP_MAX_PADS;
+        *p++ = pads;
+        for (auto i = 0; i < pads; i++)
+            p += write_gamepad(p, s.pads[i], released);
+
+        const auto changes = s.history_count < UDP_HISTORY ? s.history_count : UDP_HISTORY;
+        *p++ = changes;
+        for (auto i = 0; i < changes; i++, p += UDP_CHANGE_SIZE)
+        {
+            put_u32(p, s.history[i].number);
+            put_u16(p + 4, s.history[i].code);
+            p[6] = s.history[i].state;
+        }
+        return size_t(p - out);
+    }
+
+    /* False if the datagram is cut off or from another version */
+    inline bool read_snapshot(const uint8_t* data, const size_t length, udp_snapshot& s)
+    {
+        if (length < UDP_HEADER_SIZE + 4 + 3 || memcmp(data, UDP_MAGIC, 2) != 0
+            || data[2] != UDP_VERSION)
+            return false;
+
+        const auto end = data + length;
+        s.session = get_u32(data + 4);
+        s.sequence = get_u32(data + 8);
+        s.time = get_u64(data + 12);
+        auto p = data + UDP_HEADER_SIZE;
+
+        s.mouse_x = int16_t(get_u16(p));
+        s.mouse_y = int16_t(get_u16(p + 2));
+        p += 4;
+
+        s.keys_truncated = (*p & UDP_KEYS_TRUNCATED) != 0;
+        s.key_count = *p++ & ~UDP_KEYS_TRUNCATED;
+        if (s.key_count > UDP_MAX_KEYS || end - p < s.key_count * 2 + 1)
+            return false;
+        for (auto i = 0; i < s.key_count; i++, p += 2)
+            s.keys[i] = get_u16(p);
+
+        const frame_event released = {};
+        s.pad_count = *p++;
+        if (s.pad_count > UDP_MAX_PADS)
+            return false;
+        for (auto i = 0; i < s.pad_count; i++)
+        {
+            const auto size = read_gamepad(p, size_t(end - p), released, s.pads[i]);
+            if (!size)
+                return false;
+            p += size;
+        }
+
+        if (p == end)
+            return false;
+        s.history_count = *p++;
+        if (s.history_count > UDP_HISTORY || end - p < s.history_count * UDP_CHANGE_SIZE)
+            return false;
+        for (auto i = 0; i < s.history_count; i++, p += UDP_CHANGE_SIZE)
+        {
+            s.history[i].number = get_u32(p);
+            s.history[i].code = get_u16(p + 4);
+            s.history[i].state = p[6];
+        }
+        return true;
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "protocol.hpp"
+
+/* Room for a few frames, so one read usually takes everything that arrived */
+#define RECEIVE_BUFFER_SIZE ((FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD) * 4)
+
+namespace network
+{
+    /**
+     * Bytes received from one connection that weren't handled yet.
+     * Sockets are read straight into the free space at the end and
+     * frames are parsed where they are. Unlike a ring, the unread bytes
+     * are moved back to the start before a frame could wrap around,
+     * so every frame can be parsed in place. That only ever moves the
+     * start of one incomplete frame.
+     */
+    class receive_buffer
+    {
+    public:
+        /* Unread bytes */
+        const uint8_t* data() const { return m_data + m_read; }
+        size_t size() const { return m_write - m_read; }
+
+        /* Where the next read goes and how much fits */
+        uint8_t* free_data() { return m_data + m_write; }
+        size_t free_space() const { return sizeof(m_data) - m_write; }
+
+        void produced(const size_t bytes) { m_write += bytes; }
+
+        void consume(const size_t bytes)
+        {
+            m_read += bytes;
+            if (m_read == m_write)
+                m_read = m_write = 0;
+        }
+
+        /* Makes sure the largest frame fits behind the unread bytes */
+        void compact()
+        {
+            if (!m_read || free_space() >= FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD)
+                return;
+            memmove(m_data, m_data + m_read, size());
+            m_write -= m_read;
+            m_read = 0;
+        }
+    private:
+        uint8_t m_data[RECEIVE_BUFFER_SIZE];
+        size_t m_read = 0, m_write = 0;
+    };
+}
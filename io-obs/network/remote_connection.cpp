@@ -9,6 +9,7 @@
 #include <util/platform.h>
 #include "io_server.hpp"
 #include "remote_connection.hpp"
+#include <algorithm>
 #include <string>
 
 namespace network
@@ -111,10 +112,11 @@ namespace network
     {
         tcp_socket sock;
 
+        /* Never waits for a single client, handshakes
+         * run on the server's handshake thread */
         while (network_flag)
         {
-            int numready, i;
-			server_instance->roundtrip();
+            int numready;
             server_instance->listen(numready);
 
             if (numready == -1)
@@ -124,37 +126,22 @@ namespace network
             }
 
             if (!numready)
-            {
-                os_sleep_ms(50); /* Should be fast enough */
                 continue;
-            }
 
-            if (netlib_socket_ready(server_instance->socket()))
+            if (server_instance->accept_ready())
             {
-                numready--;
                 LOG_(LOG_INFO, "Received connection...");
                 
                 sock = netlib_tcp_accept(server_instance->socket());
 
                 if (sock)
                 {
-                    char* name = nullptr;
                     LOG_(LOG_INFO, "Accepted connection...");
-
-                    if (read_text(sock, &name))
-                    {
-                        server_instance->add_client(sock, name);
-                    }
-                    else
-                    {
-                        LOG_(LOG_ERROR, "Failed to receive client name.");
-                        netlib_tcp_close(sock);
-                    }
+                    server_instance->begin_handshake(sock);
                 }
             }
-            
-            if (numready)
-                server_instance->update_clients();
+
+            server_instance->receive_datagrams();
         }
 
 #ifdef _WIN32
@@ -178,53 +165,4 @@ namespace network
 
 		return result;
     }
-
-    /* https://www.libsdl.org/projects/SDL_net/docs/demos/tcputil.h */
-    char* read_text(tcp_socket sock, char** buf)
-    {
-        uint32_t len, result;
-
-        if (*buf)
-            free(*buf);
-        *buf = nullptr;
-
-        result = netlib_tcp_recv(sock, &len, sizeof(len));
-        if (result < sizeof(len))
-        {
-            LOG_(LOG_ERROR, "netlib_tcp_recv: %s\n", netlib_get_error());
-            return nullptr;
-        }
-
-        len = netlib_swap_BE32(len);
-        if (!len)
-            return nullptr;
-
-        *buf = static_cast<char*>(malloc(len));
-        if (!(*buf))
-            return nullptr;
-
-        result = netlib_tcp_recv(sock, *buf, len);
-        if (result < len)
-        {
-            LOG_(LOG_ERROR, "netlib_tcp_recv: %s\n", netlib_get_error());
-            free(*buf);
-            buf = nullptr;
-        }
-
-        return *buf;
-    }
-
-	message read_msg_from_buffer(netlib_byte_buf* buf)
-	{
-		uint8_t id = 0;
-		if (!netlib_read_uint8(buf, &id))
-		{
-			LOG_(LOG_ERROR, "netlib_read_uint8: %s\n", netlib_get_error());
-			return MSG_READ_ERROR;
-		}
-
-		if (id >= MSG_NAME_NOT_UNIQUE && id <= MSG_LAST)
-			return message(id);
-		return MSG_INVALID;
-    }
 }
@@ -9,6 +9,7 @@
 
 #include <netlib.h>
 #include "messages.hpp"
+#include "jitter_buffer.hpp"
 #ifdef _WIN32
 #include <Windows.h>
 #endif
@@ -38,10 +39,6 @@ namespace network
     void* network_handler(void*);
 #endif
 
-	char* read_text(tcp_socket sock, char** buf);
-
-	message read_msg_from_buffer(netlib_byte_buf* buf);
-
 	int send_message(tcp_socket sock, message msg);
 
 	extern io_server* server_instance;
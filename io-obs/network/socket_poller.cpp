@@ -0,0 +1,192 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <obs-module.h>
+#include "socket_poller.hpp"
+#include "remote_connection.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+typedef int native_socket;
+#else
+#include <winsock2.h>
+typedef SOCKET native_socket;
+#endif
+
+/* Events taken from the kernel per epoll_wait call */
+#define MAX_EVENTS 64
+
+/* netlib doesn't expose the native handle, but its sockets are
+ * SDL_net's: The ready flag (see netlib_generic_socket) is
+ * followed by the handle, for TCP and UDP sockets alike */
+struct netlib_socket_layout
+{
+    int ready;
+    native_socket channel;
+};
+
+static native_socket native_handle(netlib_generic_socket socket)
+{
+    return reinterpret_cast<netlib_socket_layout*>(socket)->channel;
+}
+
+namespace network
+{
+    socket_poller::~socket_poller()
+    {
+#ifdef __linux__
+        if (m_epoll != -1)
+            close(m_epoll);
+#else
+        if (m_set)
+            netlib_free_socket_set(m_set);
+#endif
+    }
+
+    bool socket_poller::init()
+    {
+#ifdef __linux__
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll == -1)
+        {
+            LOG_(LOG_ERROR, "epoll_create1 failed: %s", strerror(errno));
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    bool socket_poller::add(tcp_socket socket, void* user, const bool edge)
+    {
+        return add(reinterpret_cast<netlib_generic_socket>(socket), user, edge);
+    }
+
+    bool socket_poller::add(udp_socket socket, void* user, const bool edge)
+    {
+        return add(reinterpret_cast<netlib_generic_socket>(socket), user, edge);
+    }
+
+    void socket_poller::remove(tcp_socket socket)
+    {
+        remove(reinterpret_cast<netlib_generic_socket>(socket));
+    }
+
+    void socket_poller::remove(udp_socket socket)
+    {
+        remove(reinterpret_cast<netlib_generic_socket>(socket));
+    }
+
+    bool socket_poller::add(netlib_generic_socket socket, void* user, const bool edge)
+    {
+#ifdef __linux__
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | (edge ? EPOLLET : 0);
+        ev.data.ptr = user;
+
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, native_handle(socket), &ev) == -1)
+        {
+            LOG_(LOG_ERROR, "epoll_ctl failed: %s", strerror(errno));
+            return false;
+        }
+#else
+        UNUSED_PARAMETER(edge);
+        m_dirty = true;
+#endif
+        m_entries.push_back({socket, user});
+        return true;
+    }
+
+    void socket_poller::remove(netlib_generic_socket socket)
+    {
+        const auto it = std::find_if(m_entries.begin(), m_entries.end(),
+            [socket](const entry& e) { return e.socket == socket; });
+        if (it == m_entries.end())
+            return;
+
+        m_entries.erase(it);
+#ifdef __linux__
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, native_handle(socket), nullptr);
+#else
+        m_dirty = true;
+#endif
+    }
+
+    int socket_poller::wait(std::vector<ready_socket>& ready, const uint32_t timeout_ms)
+    {
+        ready.clear();
+#ifdef __linux__
+        epoll_event events[MAX_EVENTS];
+        const auto count = epoll_wait(m_epoll, events, MAX_EVENTS, int(timeout_ms));
+
+        if (count == -1)
+            return errno == EINTR ? 0 : -1;
+
+        for (auto i = 0; i < count; i++)
+        {
+            void* user = events[i].data.ptr; /* epoll_event is packed */
+            const auto hangup = (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+            ready.push_back({user, hangup});
+        }
+#else
+        if (m_dirty && !rebuild())
+            return -1;
+
+        if (netlib_check_socket_set(m_set, timeout_ms) == -1)
+            return -1;
+
+        for (const auto& e : m_entries)
+        {
+            /* Sets are level triggered, a socket that is readable
+             * without anything to read was closed */
+            if (netlib_socket_ready(e.socket))
+                ready.push_back({e.user, pending(reinterpret_cast<tcp_socket>(e.socket)) == 0});
+        }
+#endif
+        return int(ready.size());
+    }
+
+    size_t socket_poller::pending(tcp_socket socket)
+    {
+        const auto handle = native_handle(reinterpret_cast<netlib_generic_socket>(socket));
+#ifdef __linux__
+        int bytes = 0;
+        if (ioctl(handle, FIONREAD, &bytes) == -1)
+            return 0;
+#else
+        u_long bytes = 0;
+        if (ioctlsocket(handle, FIONREAD, &bytes) != 0)
+            return 0;
+#endif
+        return size_t(bytes);
+    }
+
+#ifndef __linux__
+    bool socket_poller::rebuild()
+    {
+        if (m_set)
+            netlib_free_socket_set(m_set);
+
+        m_set = netlib_alloc_socket_set(int(m_entries.size()));
+        if (!m_set)
+        {
+            LOG_(LOG_ERROR, "netlib_alloc_socket_set failed with %i sockets.",
+                int(m_entries.size()));
+            return false;
+        }
+
+        for (const auto& e : m_entries)
+            netlib_add_socket(m_set, e.socket);
+        m_dirty = false;
+        return true;
+    }
+#endif
+}
@@ -0,0 +1,75 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <netlib.h>
+#include <vector>
+
+namespace network
+{
+    /**
+     * Waits for readable sockets without rebuilding the set on every call.
+     * On Linux this is an epoll instance, sockets are registered once in
+     * add() and stay in the kernel's interest list until remove().
+     * Elsewhere a netlib socket set is used, which is only rebuilt when
+     * sockets were added or removed.
+     *
+     * Each socket carries a user pointer which wait() hands back
+     * for every socket that has data or was closed by its peer.
+     */
+    class socket_poller
+    {
+    public:
+        struct ready_socket
+        {
+            void* user;
+            /* The peer closed the connection or it failed, reported with the
+             * data it sent before, which still has to be read */
+            bool hangup;
+        };
+
+        ~socket_poller();
+
+        bool init();
+
+        /* edge: Only report new data once (EPOLLET). The caller then has
+         * to read until pending() returns zero.
+         * Sockets with blocking accepts should be level triggered */
+        bool add(tcp_socket socket, void* user, bool edge);
+        bool add(udp_socket socket, void* user, bool edge);
+        void remove(tcp_socket socket);
+        void remove(udp_socket socket);
+
+        /* Fills ready with the user pointers of all readable sockets,
+         * returns their count or -1 on error */
+        int wait(std::vector<ready_socket>& ready, uint32_t timeout_ms);
+
+        /* Bytes that can be read without blocking */
+        static size_t pending(tcp_socket socket);
+    private:
+        bool add(netlib_generic_socket socket, void* user, bool edge);
+        void remove(netlib_generic_socket socket);
+
+        struct entry
+        {
+            netlib_generic_socket socket;
+            void* user;
+        };
+
+        std::vector<entry> m_entries;
+#ifdef __linux__
+        int m_epoll = -1;
+#else
+        bool rebuild();
+
+        netlib_socket_set m_set = nullptr;
+        bool m_dirty = true;
+#endif
+    };
+}
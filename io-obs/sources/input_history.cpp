@@ -10,8 +10,6 @@
 #include <sstream>
 #include "input_history.hpp"
 #include "../util/element/element_data_holder.hpp"
-#include "../util/element/element_button.hpp"
-#include "../util/element/element_mouse_wheel.hpp"
 
 namespace sources
 {
@@ -109,45 +107,7 @@ namespace sources
 
     key_bundle input_history_source::check_keys() const
     {
-        auto temp = key_bundle();
-        if (!hook::input_data->is_empty() || GET_MASK(MASK_INCLUDE_PAD))
-        {
-            for (const auto& data : hook::input_data->m_data)
-            {
-                if (!GET_MASK(MASK_INCLUDE_PAD) && (data.first & VC_PAD_MASK))
-                    continue;
-
-                if (!GET_MASK(MASK_INCLUDE_MOUSE) && (data.first & VC_MOUSE_MASK))
-                    continue;
-
-                const auto btn = data.second->get_type() == BUTTON;
-                const auto wheel = !btn && data.second->get_type() ==
-                    MOUSE_SCROLLWHEEL;
-
-                if (btn)
-                {
-                    const auto btn_data = reinterpret_cast<element_data_button*>(
-                        data.second.get());
-
-                    if (btn_data && btn_data->get_state() == STATE_PRESSED)
-                        temp.add_key(data.first);
-                }
-                else if (wheel)
-                {
-                    element_data_wheel* wheel_data =
-                        reinterpret_cast<element_data_wheel*>(data.second.get());
-                    if (wheel_data)
-                    {
-                        if (wheel_data->get_dir() == WHEEL_DIR_UP)
-                            temp.add_key(VC_MOUSE_WHEEL_UP);
-                        else if (wheel_data->get_dir() == WHEEL_DIR_DOWN)
-                            temp.add_key(VC_MOUSE_WHEEL_DOWN);
-                    }
-                }
-            }
-        }
-
-        return temp;
+        return collect_keys(hook::input_data->snapshot(), m_bool_values);
     }
 
     void input_history_source::handle_text_history()
@@ -447,144 +407,6 @@ namespace sources
         }
     }
 
-    void key_bundle::merge(key_bundle other)
-    {
-        if (!other.m_empty)
-        {
-            m_empty = false;
-
-            for (int i = 0; i < MAX_SIMULTANEOUS_KEYS; i++)
-            {
-                if (other.m_keys[i] > 0)
-                    m_keys[i] = other.m_keys[i];
-            }
-        }
-    }
-
-    std::string key_bundle::to_string(uint8_t masks, key_names* names)
-    {
-        if (m_empty)
-            return "";
-
-        std::string text;
-        bool flag = false;
-
-        for (unsigned short key : m_keys)
-        {
-            if (key == 0)
-                break; /* Array is filled from beginning to end
-				          -> First entry with zero means there are none after it */
-
-            if (!(masks & MASK_INCLUDE_MOUSE))
-            {
-                switch (key)
-                {
-                case VC_MOUSE_BUTTON1:
-                case VC_MOUSE_BUTTON2:
-                case VC_MOUSE_BUTTON3:
-                case VC_MOUSE_BUTTON4:
-                case VC_MOUSE_BUTTON5:
-                case VC_MOUSE_WHEEL_UP:
-                case VC_MOUSE_WHEEL_DOWN:
-                    continue;
-                }
-            }
-
-            if (key > 0)
-            {
-                const char* temp = nullptr;
-
-                if (masks & MASK_TRANSLATION)
-                {
-                    temp = names->get_name(key);
-
-                    if (!temp && (masks & MASK_USE_FALLBACK))
-                        temp = key_to_text(key);
-                }
-                else
-                {
-                    temp = key_to_text(key);
-                }
-
-                if (temp)
-                {
-                    if (flag)
-                        text.append(" + ");
-                    else
-                        flag = true;
-                    text.append(temp);
-                }
-#ifdef DEBUG
-                else
-                {
-                    if (flag)
-                        text.append(" + ");
-                    else
-                        flag = true;
-                    std::stringstream stream;
-                    stream << "0x" << std::setfill('0') << std::setw(
-                            sizeof(uint16_t) * 2)
-                        << std::hex << key;
-                    text.append(stream.str());
-                }
-#endif
-            }
-        }
-
-        if ((masks & MASK_FIX_CUTTING) && !text.empty())
-            text.append(" ");
-        return text;
-    }
-
-    bool key_bundle::compare(key_bundle* other)
-    {
-        if (m_empty != other->m_empty)
-            return false;
-
-        for (auto i = 0; i < MAX_SIMULTANEOUS_KEYS; i++)
-        {
-            if (m_keys[i] != other->m_keys[i])
-                return false;
-        }
-        return true;
-    }
-
-    bool key_bundle::is_only_mouse()
-    {
-        for (auto key : m_keys)
-        {
-            switch (key)
-            {
-            case 0:
-            case VC_MOUSE_BUTTON1:
-            case VC_MOUSE_BUTTON2:
-            case VC_MOUSE_BUTTON3:
-            case VC_MOUSE_BUTTON4:
-            case VC_MOUSE_BUTTON5:
-            case VC_MOUSE_WHEEL_UP:
-            case VC_MOUSE_WHEEL_DOWN:
-                break;
-            default:
-                return false;
-            }
-        }
-        return true;
-    }
-
-    void key_bundle::add_key(const uint16_t key)
-    {
-        if (m_index > MAX_SIMULTANEOUS_KEYS)
-        {
-            blog(LOG_WARNING,
-                "[input-overlay] Input history source collected more than %i keys!\n",
-                MAX_SIMULTANEOUS_KEYS);
-            return;
-        }
-
-        m_keys[m_index] = key;
-        m_index++;
-    }
-
     bool clear_history(obs_properties_t* props, obs_property_t* property,
         void* data)
     {
@@ -727,7 +549,7 @@ namespace sources
             T_OVERLAY_INCLUDE_MOUSE);
 
         obs_property_set_modified_callback(include_pad, include_pad_changed);
-        obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0, 3, 1);
+        obs_properties_add_int(props, S_CONTROLLER_ID, T_CONTROLLER_ID, 0, PAD_COUNT - 1, 1);
         obs_properties_add_int(props, S_OVERLAY_INTERVAL, T_OVERLAY_INTERVAL, 1,
             1000, 1);
 
@@ -794,59 +616,6 @@ namespace sources
         obs_register_source(&si);
     }
 
-    void key_names::load_from_file(const std::string& path)
-    {
-        auto cfg = new ccl_config(path, "");
-
-        if (!cfg->is_empty())
-        {
-            auto node = cfg->get_first();
-
-            if (!node)
-            {
-                delete cfg;
-                return;
-            }
-
-            do
-            {
-                if (node->get_type() == 2)
-                {
-                    auto val = node->get_id();
-                    uint16_t key_code = std::stoul(val, nullptr, 16);
-                    m_names[key_code] = node->get_value();
-                }
-            }
-            while ((node = node->get_next()) != nullptr);
-        }
-
-        if (cfg->has_errors())
-        {
-            blog(LOG_WARNING, "[ccl] %s", cfg->get_error_message().c_str());
-        }
-
-        if (cfg)
-        {
-            delete cfg;
-            cfg = nullptr;
-        }
-    }
-
-    const char* key_names::get_name(const uint16_t vc)
-    {
-        if (m_names.find(vc) != m_names.end())
-        {
-            return m_names[vc].c_str();
-        }
-
-        return nullptr;
-    }
-
-    key_names::~key_names()
-    {
-        m_names.clear();
-    }
-
     key_icons::~key_icons()
     {
         unload_texture();
@@ -15,6 +15,7 @@
 #include "../util/layout_constants.hpp"
 #include "../hook/gamepad_hook.hpp"
 #include "../hook/hook_helper.hpp"
+#include "key_bundle.hpp"
 
 extern "C" {
 #include <graphics/image-file.h>
@@ -22,55 +23,12 @@ extern "C" {
 
 
 #define MAX_HISTORY_SIZE 5
-#define MAX_SIMULTANEOUS_KEYS 10
 
 #define SET_MASK(a, b)      (util_set_mask(m_bool_values, a, b))
 #define GET_MASK(a)         (m_bool_values & a)
 
-#define MASK_TEXT_MODE      1 << 0
-#define MASK_FIX_CUTTING    1 << 1
-#define MASK_INCLUDE_MOUSE  1 << 2
-#define MASK_UPDATE_KEYS    1 << 3
-#define MASK_AUTO_CLEAR     1 << 4
-#define MASK_REPEAT_KEYS    1 << 5
-#define MASK_TRANSLATION    1 << 6
-#define MASK_USE_FALLBACK   1 << 7
-#define MASK_COMMAND_MODE   1 << 8
-#define MASK_INCLUDE_PAD    1 << 9
-
 namespace sources
 {
-    class key_names;
-    class key_bundle;
-
-    class key_names
-    {
-    public:
-        void load_from_file(const std::string& path);
-        const char* get_name(uint16_t vc);
-
-        ~key_names();
-
-    private:
-        std::map<uint16_t, std::string> m_names;
-    };
-
-    class key_bundle
-    {
-    public:
-        bool m_empty = true;
-        uint16_t m_keys[MAX_SIMULTANEOUS_KEYS] = {0};
-
-        void merge(key_bundle other);
-
-        std::string to_string(uint8_t masks, key_names* names);
-        bool compare(key_bundle* other);
-        bool is_only_mouse();
-        void add_key(uint16_t key);
-    private:
-        uint8_t m_index = 0;
-    };
-
     struct command_handler
     {
         bool m_empty = true;
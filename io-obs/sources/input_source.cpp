@@ -51,7 +51,25 @@ namespace sources
         }
         else
         {
-            m_overlay->draw(effect);
+            element_data_holder* source = nullptr;
+            std::shared_ptr<network::io_client> client;
+            if (hook::data_initialized || network::network_flag)
+            {
+                if (m_settings.selected_source == 0)
+                {
+                    source = hook::input_data;
+                }
+                else if (network::server_instance)
+                {
+                    /* Held until drawing is done, a worker might
+                     * disconnect the client meanwhile */
+                    client = network::server_instance->
+                        get_client(m_settings.selected_source - 1);
+                    if (client)
+                        source = client->get_data();
+                }
+            }
+            m_overlay->draw(effect, source);
         }
     }
 
@@ -151,7 +169,7 @@ namespace sources
 
         /* Gamepad stuff */
         obs_property_set_visible(obs_properties_add_int(props, S_CONTROLLER_ID,
-            T_CONTROLLER_ID, 0, 3, 1), false);
+            T_CONTROLLER_ID, 0, PAD_COUNT - 1, 1), false);
 
 #if _WIN32 /* Linux only allows values 0 - 127 */
         obs_property_set_visible(obs_properties_add_int_slider(props, S_CONTROLLER_L_DEAD_ZONE,
@@ -0,0 +1,239 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include <iomanip>
+#include <sstream>
+#include <uiohook.h>
+#include "key_bundle.hpp"
+#include "../util/util.hpp"
+#include "../util/element/element_data_holder.hpp"
+#include "../../ccl/ccl.hpp"
+
+namespace sources
+{
+    void key_bundle::merge(key_bundle other)
+    {
+        if (!other.m_empty)
+        {
+            m_empty = false;
+
+            for (int i = 0; i < MAX_SIMULTANEOUS_KEYS; i++)
+            {
+                if (other.m_keys[i] > 0)
+                    m_keys[i] = other.m_keys[i];
+            }
+        }
+    }
+
+    std::string key_bundle::to_string(uint8_t masks, key_names* names)
+    {
+        if (m_empty)
+            return "";
+
+        std::string text;
+        bool flag = false;
+
+        for (unsigned short key : m_keys)
+        {
+            if (key == 0)
+                break; /* Array is filled from beginning to end
+				          -> First entry with zero means there are none after it */
+
+            if (!(masks & MASK_INCLUDE_MOUSE))
+            {
+                switch (key)
+                {
+                case VC_MOUSE_BUTTON1:
+                case VC_MOUSE_BUTTON2:
+                case VC_MOUSE_BUTTON3:
+                case VC_MOUSE_BUTTON4:
+                case VC_MOUSE_BUTTON5:
+                case VC_MOUSE_WHEEL_UP:
+                case VC_MOUSE_WHEEL_DOWN:
+                    continue;
+                }
+            }
+
+            if (key > 0)
+            {
+                const char* temp = nullptr;
+
+                if (masks & MASK_TRANSLATION)
+                {
+                    temp = names->get_name(key);
+
+                    if (!temp && (masks & MASK_USE_FALLBACK))
+                        temp = key_to_text(key);
+                }
+                else
+                {
+                    temp = key_to_text(key);
+                }
+
+                if (temp)
+                {
+                    if (flag)
+                        text.append(" + ");
+                    else
+                        flag = true;
+                    text.append(temp);
+                }
+#ifdef DEBUG
+                else
+                {
+                    if (flag)
+                        text.append(" + ");
+                    else
+                        flag = true;
+                    std::stringstream stream;
+                    stream << "0x" << std::setfill('0') << std::setw(
+                            sizeof(uint16_t) * 2)
+                        << std::hex << key;
+                    text.append(stream.str());
+                }
+#endif
+            }
+        }
+
+        if ((masks & MASK_FIX_CUTTING) && !text.empty())
+            text.append(" ");
+        return text;
+    }
+
+    bool key_bundle::compare(key_bundle* other)
+    {
+        if (m_empty != other->m_empty)
+            return false;
+
+        for (auto i = 0; i < MAX_SIMULTANEOUS_KEYS; i++)
+        {
+            if (m_keys[i] != other->m_keys[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool key_bundle::is_only_mouse()
+    {
+        for (auto key : m_keys)
+        {
+            switch (key)
+            {
+            case 0:
+            case VC_MOUSE_BUTTON1:
+            case VC_MOUSE_BUTTON2:
+            case VC_MOUSE_BUTTON3:
+            case VC_MOUSE_BUTTON4:
+            case VC_MOUSE_BUTTON5:
+            case VC_MOUSE_WHEEL_UP:
+            case VC_MOUSE_WHEEL_DOWN:
+                break;
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void key_bundle::add_key(const uint16_t key)
+    {
+        if (m_index >= MAX_SIMULTANEOUS_KEYS)
+        {
+            blog(LOG_WARNING,
+                "[input-overlay] Input history source collected more than %i keys!\n",
+                MAX_SIMULTANEOUS_KEYS);
+            return;
+        }
+
+        m_keys[m_index] = key;
+        m_index++;
+    }
+
+    void key_names::load_from_file(const std::string& path)
+    {
+        auto cfg = new ccl_config(path, "");
+
+        if (!cfg->is_empty())
+        {
+            auto node = cfg->get_first();
+
+            if (!node)
+            {
+                delete cfg;
+                return;
+            }
+
+            do
+            {
+                if (node->get_type() == 2)
+                {
+                    auto val = node->get_id();
+                    uint16_t key_code = std::stoul(val, nullptr, 16);
+                    m_names[key_code] = node->get_value();
+                }
+            }
+            while ((node = node->get_next()) != nullptr);
+        }
+
+        if (cfg->has_errors())
+        {
+            blog(LOG_WARNING, "[ccl] %s", cfg->get_error_message().c_str());
+        }
+
+        if (cfg)
+        {
+            delete cfg;
+            cfg = nullptr;
+        }
+    }
+
+    const char* key_names::get_name(const uint16_t vc)
+    {
+        if (m_names.find(vc) != m_names.end())
+        {
+            return m_names[vc].c_str();
+        }
+
+        return nullptr;
+    }
+
+    key_names::~key_names()
+    {
+        m_names.clear();
+    }
+
+    key_bundle collect_keys(const input_state* state, const uint16_t masks)
+    {
+        auto temp = key_bundle();
+
+        if (!state->is_empty() || (masks & MASK_INCLUDE_PAD))
+        {
+            const auto filtered = [masks](const uint16_t vc)
+            {
+                return (!(masks & MASK_INCLUDE_PAD) && (vc & VC_PAD_MASK)) ||
+                    (!(masks & MASK_INCLUDE_MOUSE) && (vc & VC_MOUSE_MASK));
+            };
+
+            state->for_each_pressed([&](const uint16_t vc)
+            {
+                if (!filtered(vc))
+                    temp.add_key(vc);
+            });
+
+            if (!filtered(VC_MOUSE_WHEEL))
+            {
+                const auto dir = state->get_wheel().dir;
+                if (dir == WHEEL_DIR_UP)
+                    temp.add_key(VC_MOUSE_WHEEL_UP);
+                else if (dir == WHEEL_DIR_DOWN)
+                    temp.add_key(VC_MOUSE_WHEEL_DOWN);
+            }
+        }
+
+        return temp;
+    }
+}
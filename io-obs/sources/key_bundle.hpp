@@ -0,0 +1,63 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#define MAX_SIMULTANEOUS_KEYS 10
+
+#define MASK_TEXT_MODE      1 << 0
+#define MASK_FIX_CUTTING    1 << 1
+#define MASK_INCLUDE_MOUSE  1 << 2
+#define MASK_UPDATE_KEYS    1 << 3
+#define MASK_AUTO_CLEAR     1 << 4
+#define MASK_REPEAT_KEYS    1 << 5
+#define MASK_TRANSLATION    1 << 6
+#define MASK_USE_FALLBACK   1 << 7
+#define MASK_COMMAND_MODE   1 << 8
+#define MASK_INCLUDE_PAD    1 << 9
+
+struct input_state;
+
+namespace sources
+{
+    class key_names
+    {
+    public:
+        void load_from_file(const std::string& path);
+        const char* get_name(uint16_t vc);
+
+        ~key_names();
+
+    private:
+        std::map<uint16_t, std::string> m_names;
+    };
+
+    class key_bundle
+    {
+    public:
+        bool m_empty = true;
+        uint16_t m_keys[MAX_SIMULTANEOUS_KEYS] = {0};
+
+        void merge(key_bundle other);
+
+        std::string to_string(uint8_t masks, key_names* names);
+        bool compare(key_bundle* other);
+        bool is_only_mouse();
+        void add_key(uint16_t key);
+    private:
+        uint8_t m_index = 0;
+    };
+
+    /* Keys held down in state, masks decides whether
+     * mouse buttons and gamepad buttons are included
+     */
+    key_bundle collect_keys(const input_state* state, uint16_t masks);
+}
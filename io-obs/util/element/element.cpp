@@ -9,16 +9,6 @@
 #include "../../../ccl/ccl.hpp"
 #include "util/layout_constants.hpp"
 
-element_data::element_data(const element_type type)
-{
-    m_type = type;
-}
-
-element_type element_data::get_type() const
-{
-    return m_type;
-}
-
 element::element() : m_keycode(0)
 {
     m_type = INVALID;
@@ -39,9 +29,9 @@ uint16_t element::get_keycode() const
     return m_keycode;
 }
 
-data_source element::get_source()
+void element::set_slot(const uint32_t slot)
 {
-    return NONE;
+    m_slot = slot;
 }
 
 void element::read_mapping(ccl_config* cfg, const std::string& id)
@@ -10,20 +10,6 @@
 #include "graphics/vec2.h"
 #include "graphics/graphics.h"
 
-typedef struct gs_image_file gs_image_file_t;
-
-/**
- * Which data holder to read element
- * data from
- */
-enum data_source
-{
-    NONE = -1,
-    DEFAULT,
-    GAMEPAD,
-    MOUSE_POS
-};
-
 namespace sources
 {
     class shared_settings;
@@ -31,30 +17,15 @@ namespace sources
 
 class ccl_config;
 
+struct input_state;
+
+class sprite_batch;
+
 #ifdef _WIN32
 enum element_type;
 #else
 #include "../layout_constants.hpp"
 #endif
-class element_data
-{
-public:
-    element_data(element_type type);
-
-    element_type get_type() const;
-
-    /* true if data should not me removed */
-    virtual bool is_persistent() { return false; }
-
-    /* used if is persistent */
-    virtual void merge(element_data* other)
-    {
-        /* NO-OP */
-    }
-protected:
-    element_type m_type;
-};
-
 class element
 {
 public:
@@ -66,14 +37,15 @@ public:
 
     virtual void load(ccl_config* cfg, const std::string& id) = 0;
 
-    virtual void draw(gs_effect_t* effect, gs_image_file_t* m_image,
-        element_data* data, sources::shared_settings* settings) = 0;
+    /* Number of sprite batch slots this element draws into */
+    virtual uint8_t quad_count() const { return 1; }
 
     element_type get_type() const;
 
     uint16_t get_keycode() const;
 
-    virtual data_source get_source();
+    /* First sprite batch slot of this element, assigned in layout order */
+    void set_slot(uint32_t slot);
 protected:
     void read_mapping(ccl_config* cfg, const std::string& id);
 
@@ -84,4 +56,5 @@ protected:
 
     element_type m_type;
     uint16_t m_keycode;
+    uint32_t m_slot = 0;
 };
@@ -7,6 +7,7 @@
 
 #include "../../sources/input_source.hpp"
 #include "element_analog_stick.hpp"
+#include "element_data_holder.hpp"
 #include "../../../ccl/ccl.hpp"
 #include "../util.hpp"
 
@@ -20,96 +21,55 @@ void element_analog_stick::load(ccl_config* cfg, const std::string& id)
     m_pressed.y = m_mapping.y + m_mapping.cy + CFG_INNER_BORDER;
 }
 
-void element_analog_stick::draw(gs_effect_t* effect, gs_image_file_t* image,
-    element_data* data, sources::shared_settings* settings)
+void element_analog_stick::draw(sprite_batch* batch, const input_state* data,
+    sources::shared_settings* settings) const
 {
-    if (data)
+    const auto pad = data ? data->get_gamepad(settings->gamepad) : nullptr;
+
+    if (pad)
     {
-        const auto stick = dynamic_cast<element_data_analog_stick*>(data);
-        if (stick)
-        {
-            auto pos = m_pos;
-            gs_rect* temp = nullptr;
+        const auto stick = pad->stick();
+        auto pos = m_pos;
+        const gs_rect* temp = nullptr;
 
-            if (m_side == SIDE_LEFT)
-                temp = stick->left_pressed() ? &m_pressed : &m_mapping;
-            else
-                temp = stick->right_pressed() ? &m_pressed : &m_mapping;
-            calc_position(&pos, stick, settings);
-            element_texture::draw(effect, image, temp, &pos);
-        }
+        if (m_side == SIDE_LEFT)
+            temp = stick.left_state == STATE_PRESSED ? &m_pressed : &m_mapping;
+        else
+            temp = stick.right_state == STATE_PRESSED ? &m_pressed : &m_mapping;
+        calc_position(&pos, &stick, settings);
+        element_texture::draw(batch, temp, &pos);
     }
     else
     {
-        element_texture::draw(effect, image, nullptr);
+        element_texture::draw(batch, nullptr);
     }
 }
 
 void element_analog_stick::calc_position(
-    vec2* v, element_data_analog_stick* d, sources::shared_settings* settings) const
+    vec2* v, const stick_state* d, sources::shared_settings* settings) const
 {
     switch (m_side)
     {
     case SIDE_LEFT:
 #if HAVE_XINPUT
-        if (!DEAD_ZONE(d->get_left_stick()->x, settings->left_dz))
+        if (!DEAD_ZONE(d->left.x, settings->left_dz))
 #endif
-            v->x += d->get_left_stick()->x * m_radius;
+            v->x += d->left.x * m_radius;
 #if HAVE_XINPUT
-        if (!DEAD_ZONE(d->get_left_stick()->y, settings->left_dz))
+        if (!DEAD_ZONE(d->left.y, settings->left_dz))
 #endif
-            v->y += d->get_left_stick()->y * m_radius;
+            v->y += d->left.y * m_radius;
         break;
     case SIDE_RIGHT:
 #if HAVE_XINPUT
-        if (!DEAD_ZONE(d->get_right_stick()->x, settings->right_dz))
+        if (!DEAD_ZONE(d->right.x, settings->right_dz))
 #endif
-            v->x += d->get_right_stick()->x * m_radius;
+            v->x += d->right.x * m_radius;
 #if HAVE_XINPUT
-        if (!DEAD_ZONE(d->get_right_stick()->y, settings->right_dz))
+        if (!DEAD_ZONE(d->right.y, settings->right_dz))
 #endif
-            v->y += d->get_right_stick()->y * m_radius;
+            v->y += d->right.y * m_radius;
         break;
     default: ;
     }
 }
-
-void element_data_analog_stick::merge(element_data* other)
-{
-    if (other && other->get_type() == m_type)
-    {
-        const auto other_stick
-            = dynamic_cast<element_data_analog_stick*>(other);
-        if (other_stick)
-        {
-            switch (other_stick->m_data_type)
-            {
-            case BOTH:
-                m_left_stick = other_stick->m_left_stick;
-                m_right_stick = other_stick->m_right_stick;
-                m_left_state = other_stick->m_left_state;
-                m_right_state = other_stick->m_right_state;
-                break;
-            case PRESSED_STATE_LEFT:
-                m_left_state = other_stick->m_left_state;
-                break;
-            case PRESSED_STATE_RIGHT:
-                m_right_state = other_stick->m_right_state;
-                break;
-            case STICK_STATE_LEFT_X:
-                m_left_stick.x = other_stick->m_left_stick.x;
-                break;
-            case STICK_STATE_LEFT_Y:
-                m_left_stick.y = other_stick->m_left_stick.y;
-                break;
-            case STICK_STATE_RIGHT_X:
-                m_right_stick.x = other_stick->m_right_stick.x;
-                break;
-            case STICK_STATE_RIGHT_Y:
-                m_right_stick.y = other_stick->m_right_stick.y;
-                break;
-            default: ;
-            }
-        }
-    }
-}
@@ -7,19 +7,9 @@
 
 #include "../../sources/input_source.hpp"
 #include "element_button.hpp"
+#include "element_data_holder.hpp"
 #include "../../../ccl/ccl.hpp"
-
-element_data_button* element_data_button::from_buffer(netlib_byte_buf* buffer)
-{
-	uint8_t state = 0;
-
-    if (!netlib_read_uint8(buffer, &state))
-    {
-		return nullptr;
-    }
-
-	return new element_data_button(button_state(state));
-}
+#include "../sprite_batch.hpp"
 
 void element_button::load(ccl_config* cfg, const std::string& id)
 {
@@ -31,26 +21,43 @@ void element_button::load(ccl_config* cfg, const std::string& id)
     is_gamepad = (m_keycode >> 8) == (VC_PAD_MASK >> 8);
 }
 
-void element_button::draw(gs_effect_t* effect, gs_image_file_t* image,
-    element_data* data, sources::shared_settings* settings)
+void button_table::add(const element_button& button)
 {
-    if (data)
+    m_keycodes.emplace_back(button.m_keycode);
+    m_gamepad.emplace_back(button.is_gamepad);
+    m_slots.emplace_back(button.m_slot);
+    m_pos.emplace_back(button.m_pos);
+    m_mappings.emplace_back(button.m_mapping);
+    m_pressed.emplace_back(button.m_pressed);
+}
+
+void button_table::clear()
+{
+    m_keycodes.clear();
+    m_gamepad.clear();
+    m_slots.clear();
+    m_pos.clear();
+    m_mappings.clear();
+    m_pressed.clear();
+}
+
+void button_table::draw(sprite_batch* batch, const input_state* data,
+    const sources::shared_settings* settings) const
+{
+    const auto count = m_keycodes.size();
+
+    if (!data)
     {
-        const auto button = dynamic_cast<element_data_button*>(data);
-        if (button)
-        {
-            if (button->get_state() == STATE_PRESSED)
-            {
-                element_texture::draw(effect, image, &m_pressed);
-            }
-            else
-            {
-                element_texture::draw(effect, image, nullptr);
-            }
-        }
+        for (size_t i = 0; i < count; i++)
+            batch->set(m_slots[i], &m_mappings[i], &m_pos[i]);
+        return;
     }
-    else
+
+    for (size_t i = 0; i < count; i++)
     {
-        element_texture::draw(effect, image, nullptr);
+        const auto pressed = m_gamepad[i] ?
+            data->gamepad_button_pressed(settings->gamepad, m_keycodes[i]) :
+            data->button_pressed(m_keycodes[i]);
+        batch->set(m_slots[i], pressed ? &m_pressed[i] : &m_mappings[i], &m_pos[i]);
     }
 }
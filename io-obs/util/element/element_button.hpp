@@ -9,39 +9,46 @@
 
 #include "../layout_constants.hpp"
 #include "element_texture.hpp"
-#include <netlib.h>
+#include <vector>
 
-class element_data_button : public element_data
+class element_button : public element_texture
 {
 public:
-    element_data_button(const button_state state)
-        : element_data(BUTTON)
+    element_button() : element_texture(BUTTON), m_pressed()
     {
-        m_state = state;
     }
 
-    button_state get_state() const
-    {
-        return m_state;
-    }
-	static element_data_button* from_buffer(netlib_byte_buf* buffer);
+    void load(ccl_config* cfg, const std::string& id) override;
 private:
-    button_state m_state;
+    friend class button_table;
+    bool is_gamepad = false;
+    gs_rect m_pressed;
 };
 
-class element_button : public element_texture
+/**
+ * Buttons make up most of a layout, so instead of keeping
+ * element_button objects around they're stored as plain
+ * arrays, which are walked in one loop when drawing.
+ */
+class button_table
 {
 public:
-    element_button() : element_texture(BUTTON), m_pressed()
+    void add(const element_button& button);
+    void clear();
+
+    void draw(sprite_batch* batch, const input_state* data,
+        const sources::shared_settings* settings) const;
+
+    size_t size() const
     {
+        return m_keycodes.size();
     }
 
-    void load(ccl_config* cfg, const std::string& id) override;
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
-
-    data_source get_source() override { return is_gamepad ? GAMEPAD : DEFAULT; }
 private:
-    bool is_gamepad = false;
-    gs_rect m_pressed;
+    std::vector<uint16_t> m_keycodes;
+    std::vector<uint8_t> m_gamepad;
+    std::vector<uint32_t> m_slots;
+    std::vector<vec2> m_pos;
+    std::vector<gs_rect> m_mappings;
+    std::vector<gs_rect> m_pressed;
 };
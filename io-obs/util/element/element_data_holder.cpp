@@ -5,145 +5,521 @@
  * github.com/univrsal/input-overlay
  */
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include "element_data_holder.hpp"
-#include "element_trigger.hpp"
+#include "../latency.hpp"
 
-element_data_holder::element_data_holder()
+#define KEY_WORD(vc)    ((vc) >> 6)
+#define KEY_BIT(vc)     (uint64_t(1) << ((vc) & 63))
+
+#define SNAPSHOT_NEW    0x80
+#define SNAPSHOT_INDEX  0x03
+
+/* gamepad_data */
+
+static const struct
+{
+    uint16_t bit;
+    uint16_t button;
+} pad_buttons[] = {
+    {PAD_BIT_A, PAD_A},
+    {PAD_BIT_B, PAD_B},
+    {PAD_BIT_X, PAD_X},
+    {PAD_BIT_Y, PAD_Y},
+    {PAD_BIT_GUIDE, PAD_X_BOX_KEY},
+    {PAD_BIT_DPAD_DOWN, PAD_DPAD_DOWN},
+    {PAD_BIT_DPAD_UP, PAD_DPAD_UP},
+    {PAD_BIT_DPAD_LEFT, PAD_DPAD_LEFT},
+    {PAD_BIT_DPAD_RIGHT, PAD_DPAD_RIGHT},
+    {PAD_BIT_LB, PAD_LB},
+    {PAD_BIT_RB, PAD_RB},
+    {PAD_BIT_START, PAD_START},
+    {PAD_BIT_BACK, PAD_BACK}
+};
+
+/* Same order as xinput_fix::get_dpad() */
+static const struct
+{
+    uint16_t bit;
+    dpad_direction dir;
+} pad_directions[] = {
+    {PAD_BIT_DPAD_UP, DPAD_UP},
+    {PAD_BIT_DPAD_DOWN, DPAD_DOWN},
+    {PAD_BIT_DPAD_LEFT, DPAD_LEFT},
+    {PAD_BIT_DPAD_RIGHT, DPAD_RIGHT}
+};
+
+static int16_t to_axis(const float value)
 {
-    m_data = std::map<uint16_t, std::unique_ptr<element_data>>();
+    return int16_t(UTIL_CLAMP(-1.f, value, 1.f) * PAD_AXIS_MAX);
 }
 
-element_data_holder::~element_data_holder()
+static uint8_t to_trigger(const float value)
 {
-    m_data.clear();
-    m_map_cleared = true;
+    return uint8_t(UTIL_CLAMP(0.f, value, 1.f) * PAD_TRIGGER_MAX);
 }
 
-bool element_data_holder::is_empty() const
+void gamepad_data::set_button(const uint16_t keycode, const button_state state)
 {
-    auto flag = true;
+    const auto code = keycode & 0xFF;
+    if (code >= 32)
+        return;
 
-    for (const auto& pad : m_gamepad_data)
+    if (state == STATE_PRESSED)
+        buttons |= 1u << code;
+    else
+        buttons &= ~(1u << code);
+}
+
+bool gamepad_data::pressed(const uint16_t keycode) const
+{
+    const auto code = keycode & 0xFF;
+    return code < 32 && (buttons & 1u << code) != 0;
+}
+
+void gamepad_data::set_stick(const stick_state& stick)
+{
+    axes[STICK_STATE_LEFT_X] = to_axis(stick.left.x);
+    axes[STICK_STATE_LEFT_Y] = to_axis(stick.left.y);
+    axes[STICK_STATE_RIGHT_X] = to_axis(stick.right.x);
+    axes[STICK_STATE_RIGHT_Y] = to_axis(stick.right.y);
+    set_button(PAD_L_ANALOG, stick.left_state);
+    set_button(PAD_R_ANALOG, stick.right_state);
+}
+
+void gamepad_data::set_axis(const stick_data_type axis, const float value)
+{
+    if (axis >= STICK_STATE_LEFT_X && axis <= STICK_STATE_RIGHT_Y)
+        axes[axis] = to_axis(value);
+}
+
+stick_state gamepad_data::stick() const
+{
+    stick_state stick;
+    stick.left = {axes[STICK_STATE_LEFT_X] / PAD_AXIS_MAX, axes[STICK_STATE_LEFT_Y] / PAD_AXIS_MAX};
+    stick.right = {axes[STICK_STATE_RIGHT_X] / PAD_AXIS_MAX, axes[STICK_STATE_RIGHT_Y] / PAD_AXIS_MAX};
+    stick.left_state = pressed(PAD_L_ANALOG) ? STATE_PRESSED : STATE_RELEASED;
+    stick.right_state = pressed(PAD_R_ANALOG) ? STATE_PRESSED : STATE_RELEASED;
+    return stick;
+}
+
+void gamepad_data::set_trigger(const element_side side, const float value)
+{
+    triggers[side == SIDE_LEFT ? 0 : 1] = to_trigger(value);
+}
+
+trigger_state gamepad_data::trigger() const
+{
+    trigger_state trigger;
+    trigger.left = triggers[0] / PAD_TRIGGER_MAX;
+    trigger.right = triggers[1] / PAD_TRIGGER_MAX;
+    return trigger;
+}
+
+void gamepad_data::set_xinput(const uint16_t bits, const float sticks[4],
+    const float left_trigger, const float right_trigger)
+{
+    dpad_direction dirs[] = {DPAD_CENTER, DPAD_CENTER};
+    auto dir_count = 0;
+
+    for (const auto& b : pad_buttons)
+        set_button(b.button, bits & b.bit ? STATE_PRESSED : STATE_RELEASED);
+
+    for (const auto& d : pad_directions)
     {
-        if (pad.empty())
-        {
-            flag = false;
-            break;
-        }
+        if (bits & d.bit && dir_count < 2)
+            dirs[dir_count++] = d.dir;
     }
+    dpad = element_data_holder::merge_directions(dirs[0], dirs[1]);
+
+    /* Same orientation as local xinput sticks */
+    axes[STICK_STATE_LEFT_X] = to_axis(sticks[0]);
+    axes[STICK_STATE_LEFT_Y] = to_axis(-sticks[1]);
+    axes[STICK_STATE_RIGHT_X] = to_axis(sticks[2]);
+    axes[STICK_STATE_RIGHT_Y] = to_axis(-sticks[3]);
+    set_button(PAD_L_ANALOG, bits & PAD_BIT_L_ANALOG ? STATE_PRESSED : STATE_RELEASED);
+    set_button(PAD_R_ANALOG, bits & PAD_BIT_R_ANALOG ? STATE_PRESSED : STATE_RELEASED);
+
+    triggers[0] = to_trigger(left_trigger);
+    triggers[1] = to_trigger(right_trigger);
+}
 
-    return (m_map_cleared || m_data.empty()) && flag;
+bool gamepad_data::operator==(const gamepad_data& other) const
+{
+    return memcmp(this, &other, sizeof(gamepad_data)) == 0;
+}
+
+/* input_state */
+
+bool input_state::button_pressed(const uint16_t keycode) const
+{
+    return (buttons[KEY_WORD(keycode)] & KEY_BIT(keycode)) != 0;
 }
 
-void element_data_holder::add_data(const uint16_t keycode, element_data* data)
+bool input_state::gamepad_button_pressed(const uint8_t pad, const uint16_t keycode) const
+{
+    return pad < PAD_COUNT && gamepads[pad].pressed(keycode);
+}
+
+const wheel_state& input_state::get_wheel() const
+{
+    return wheel;
+}
+
+const gamepad_data* input_state::get_gamepad(const uint8_t pad) const
+{
+    if (pad >= PAD_COUNT)
+        return nullptr;
+    return &gamepads[pad];
+}
+
+bool input_state::is_empty() const
+{
+    return !pressed_count && wheel.dir == WHEEL_DIR_NONE;
+}
+
+/* element_data_holder */
+
+element_data_holder::element_data_holder()
+    : m_middle(1)
+{
+}
+
+void element_data_holder::set_button(const uint16_t keycode, const button_state state)
 {
 #ifdef _DEBUG
     blog(LOG_INFO, "Incoming: 0x%4X\n", keycode);
 #endif
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    auto& data = back();
+    auto& word = data.buttons[KEY_WORD(keycode)];
+    const auto was_pressed = (word & KEY_BIT(keycode)) != 0;
 
-    m_data_locked = true;
-    if (data_exists(keycode))
+    if (state == STATE_PRESSED && !was_pressed)
     {
-        if (m_data[keycode]->is_persistent())
-        {
-            m_data[keycode]->merge(data);
-            delete data; /* Existing data was used -> delete other one */
-        }
-        else
-        {
-            remove_data(keycode);
-            m_data[keycode] = std::unique_ptr<element_data>(data);
-        }
+        word |= KEY_BIT(keycode);
+        data.pressed_count++;
+        m_changed = true;
     }
-    else
+    else if (state == STATE_RELEASED && was_pressed)
     {
-        m_data[keycode] = std::unique_ptr<element_data>(data);
+        word &= ~KEY_BIT(keycode);
+        data.pressed_count--;
+        m_changed = true;
     }
-    m_data_locked = false;
 }
 
-void element_data_holder::add_gamepad_data(const uint8_t gamepad,
-    const uint16_t keycode,
-    element_data* data)
+void element_data_holder::set_pressed_keys(const uint16_t* keys, const size_t count,
+    const bool complete)
 {
-    m_gamepad_data_locked = true;
-    if (gamepad_data_exists(gamepad, keycode))
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    auto& data = back();
+
+    if (complete)
     {
-        if (m_gamepad_data[gamepad][keycode]->is_persistent())
+        data.for_each_pressed([&](const uint16_t keycode)
         {
-            m_gamepad_data[gamepad][keycode]->merge(data);
+            if (std::find(keys, keys + count, keycode) == keys + count)
+            {
+                data.buttons[KEY_WORD(keycode)] &= ~KEY_BIT(keycode);
+                data.pressed_count--;
+                m_changed = true;
+            }
+        });
+    }
 
-            delete data; /* Existing data was used -> delete other one */
-        }
-        else
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& word = data.buttons[KEY_WORD(keys[i])];
+        if (!(word & KEY_BIT(keys[i])))
         {
-            remove_gamepad_data(gamepad, keycode);
-            m_gamepad_data[gamepad][keycode] = std::unique_ptr<element_data>(data);
+            word |= KEY_BIT(keys[i]);
+            data.pressed_count++;
+            m_changed = true;
         }
     }
+}
+
+void element_data_holder::set_wheel_button(const button_state state)
+{
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    back().wheel.middle = state;
+    m_changed = true;
+}
+
+void element_data_holder::set_wheel(const wheel_direction dir, const int amount)
+{
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    back().wheel.dir = dir;
+    back().wheel.amount = amount;
+    m_changed = true;
+}
+
+void element_data_holder::add_wheel(const wheel_direction dir, const int amount)
+{
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    auto& wheel = back().wheel;
+
+    if (wheel.dir != dir)
+        wheel.amount = amount;
     else
+        wheel.amount += amount;
+    wheel.dir = dir;
+    m_changed = true;
+}
+
+void element_data_holder::set_mouse(const mouse_state& mouse)
+{
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    auto& data = back().mouse;
+
+    if (memcmp(&data, &mouse, sizeof(mouse_state)) != 0)
     {
-        m_gamepad_data[gamepad][keycode] = std::unique_ptr<element_data>(data);
+        data = mouse;
+        m_changed = true;
     }
-    m_gamepad_data_locked = false;
 }
 
-bool element_data_holder::gamepad_data_exists(const uint8_t gamepad, const uint16_t keycode)
+void element_data_holder::set_gamepad(const uint8_t pad, const gamepad_data& data)
 {
-    if (is_empty())
-        return false;
-    return m_gamepad_data[gamepad][keycode] != nullptr;
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        if (current == data)
+            return false;
+        current = data;
+        return true;
+    });
 }
 
-void element_data_holder::remove_gamepad_data(const uint8_t gamepad, const uint16_t keycode)
+void element_data_holder::set_gamepad_button(const uint8_t pad, const uint16_t keycode,
+    const button_state state)
 {
-    m_gamepad_data_locked = true;
-    if (gamepad_data_exists(gamepad, keycode))
+    update_gamepad(pad, [&](gamepad_data& current)
     {
-        m_gamepad_data[gamepad][keycode].reset(nullptr);
-        m_gamepad_data[gamepad].erase(keycode);
-    }
-    m_gamepad_data_locked = false;
+        const auto old = current.buttons;
+        current.set_button(keycode, state);
+        return old != current.buttons;
+    });
 }
 
-element_data* element_data_holder::get_by_gamepad(const uint8_t gamepad, const uint16_t keycode)
+void element_data_holder::set_gamepad_stick(const uint8_t pad, const stick_state& stick)
 {
-    if (m_gamepad_data_locked)
+    update_gamepad(pad, [&](gamepad_data& current)
     {
-#ifdef _DEBUG
-        blog(LOG_INFO, "Suppressed game pad access, data is locked");
-#endif
-        return nullptr;
+        const auto old = current;
+        current.set_stick(stick);
+        return !(old == current);
+    });
+}
+
+void element_data_holder::set_gamepad_axis(const uint8_t pad, const stick_data_type axis,
+    const float value)
+{
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        const auto old = current;
+        current.set_axis(axis, value);
+        return !(old == current);
+    });
+}
+
+void element_data_holder::set_gamepad_stick_button(const uint8_t pad, const element_side side,
+    const button_state state)
+{
+    set_gamepad_button(pad, side == SIDE_LEFT ? PAD_L_ANALOG : PAD_R_ANALOG, state);
+}
+
+void element_data_holder::set_gamepad_trigger(const uint8_t pad, const float left, const float right)
+{
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        const auto old = current;
+        current.set_trigger(SIDE_LEFT, left);
+        current.set_trigger(SIDE_RIGHT, right);
+        return !(old == current);
+    });
+}
+
+void element_data_holder::set_gamepad_trigger(const uint8_t pad, const element_side side,
+    const float value)
+{
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        const auto old = current;
+        current.set_trigger(side, value);
+        return !(old == current);
+    });
+}
+
+void element_data_holder::set_gamepad_dpad(const uint8_t pad, const dpad_direction a,
+    const dpad_direction b)
+{
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        const auto old = current.dpad;
+        current.dpad = merge_directions(a, b);
+        return old != current.dpad;
+    });
+}
+
+/* Removes a released direction from the current one */
+static dpad_direction release_direction(const dpad_direction dir, const dpad_direction d)
+{
+    if (dir == d)
+        return DPAD_CENTER;
+
+    switch (dir)
+    {
+    case DPAD_TOP_LEFT:
+        switch (d)
+        {
+        case DPAD_LEFT: return DPAD_UP;
+        case DPAD_UP: return DPAD_LEFT;
+        default: ;
+        }
+        break;
+    case DPAD_TOP_RIGHT:
+        switch (d)
+        {
+        case DPAD_UP: return DPAD_RIGHT;
+        case DPAD_RIGHT: return DPAD_UP;
+        default: ;
+        }
+        break;
+    case DPAD_BOTTOM_LEFT:
+        switch (d)
+        {
+        case DPAD_LEFT: return DPAD_DOWN;
+        case DPAD_DOWN: return DPAD_LEFT;
+        default: ;
+        }
+        break;
+    case DPAD_BOTTOM_RIGHT:
+        switch (d)
+        {
+        case DPAD_RIGHT: return DPAD_DOWN;
+        case DPAD_DOWN: return DPAD_RIGHT;
+        default: ;
+        }
+        break;
+    default: ;
     }
-    return m_gamepad_data[gamepad][keycode].get();
+    return dir;
 }
 
-bool element_data_holder::data_exists(const uint16_t keycode)
+void element_data_holder::set_gamepad_dpad(const uint8_t pad, const dpad_direction d,
+    const button_state state)
 {
-    if (is_empty())
-        return false;
-    return m_data[keycode] != nullptr;
+    update_gamepad(pad, [&](gamepad_data& current)
+    {
+        const auto old = current.dpad;
+        if (state == STATE_PRESSED)
+            current.dpad = merge_directions(current.get_dpad(), d);
+        else
+            current.dpad = release_direction(current.get_dpad(), d);
+        return old != current.dpad;
+    });
 }
 
-void element_data_holder::remove_data(const uint16_t keycode)
+void element_data_holder::set_event_time(const uint64_t ns)
 {
-    m_data_locked = true;
-    if (data_exists(keycode))
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    if (!back().event_time)
+        back().event_time = ns;
+}
+
+void element_data_holder::publish()
+{
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    if (!m_changed)
     {
-        m_data[keycode].reset(nullptr);
-        m_data.erase(keycode);
+        /* Events that didn't change anything aren't measured */
+        back().event_time = 0;
+        return;
     }
-    m_data_locked = false;
+
+    const auto published = m_write;
+    m_states[published].generation++;
+    latency::record(latency::STAGE_PUBLISH, m_states[published].event_time);
+    m_write = m_middle.exchange(published | SNAPSHOT_NEW, std::memory_order_acq_rel) & SNAPSHOT_INDEX;
+
+    /* The new back buffer is outdated, bring it up to date. The reader
+     * might be looking at the published one too, but both only read
+     * this part of it. The pads behind it belong to the reader */
+    memcpy(static_cast<void*>(&m_states[m_write]), &m_states[published],
+        offsetof(input_state, pad_generation));
+    m_states[m_write].event_time = 0;
+    m_changed = false;
 }
 
-element_data* element_data_holder::get_by_code(const uint16_t keycode)
+const input_state* element_data_holder::snapshot()
 {
-    if (m_data_locked || m_data.empty())
+    if (m_middle.load(std::memory_order_relaxed) & SNAPSHOT_NEW)
+        m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & SNAPSHOT_INDEX;
+
+    auto& state = m_states[m_read];
+    for (auto i = 0; i < PAD_COUNT; i++)
     {
-#ifdef _DEBUG
-        blog(LOG_INFO, "Suppressed input access, data is locked");
-#endif
-        return nullptr;
+        const auto seq = m_pads[i].read(state.gamepads[i]);
+        if (seq != m_pad_seqs[i])
+        {
+            m_pad_seqs[i] = seq;
+            m_pad_generation++;
+        }
+    }
+    state.pad_generation = m_pad_generation;
+    return &state;
+}
+
+dpad_direction element_data_holder::merge_directions(const dpad_direction a, const dpad_direction b)
+{
+    switch (a)
+    {
+    case DPAD_UP:
+        switch (b)
+        {
+        case DPAD_LEFT:
+            return DPAD_TOP_LEFT;
+        case DPAD_RIGHT:
+            return DPAD_TOP_RIGHT;
+        default:
+            return DPAD_UP;
+        }
+    case DPAD_DOWN:
+        switch (b)
+        {
+        case DPAD_LEFT:
+            return DPAD_BOTTOM_LEFT;
+        case DPAD_RIGHT:
+            return DPAD_BOTTOM_RIGHT;
+        default:
+            return DPAD_DOWN;
+        }
+    case DPAD_LEFT:
+        switch (b)
+        {
+        case DPAD_UP:
+            return DPAD_TOP_LEFT;
+        case DPAD_DOWN:
+            return DPAD_BOTTOM_LEFT;
+        default:
+            return DPAD_LEFT;
+        }
+    case DPAD_RIGHT:
+        switch (b)
+        {
+        case DPAD_UP:
+            return DPAD_TOP_RIGHT;
+        case DPAD_DOWN:
+            return DPAD_BOTTOM_RIGHT;
+        default:
+            return DPAD_RIGHT;
+        }
+    case DPAD_CENTER:
+        return b;
+    default:
+        return a;
     }
-    return m_data[keycode].get();
 }
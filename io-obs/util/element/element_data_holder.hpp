@@ -6,36 +6,230 @@
  */
 
 #pragma once
-#include "element.hpp"
-#include <map>
-#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "graphics/vec2.h"
+#include "../layout_constants.hpp"
+#include "../util.hpp"
+#include "../seqlock.hpp"
 
+/* One bit per key code, 8KB in total */
+#define KEY_TABLE_SIZE      (0x10000 / 64)
+/* gamepad_data keeps axes and triggers in these ranges */
+#define PAD_AXIS_MAX        32767.f
+#define PAD_TRIGGER_MAX     255.f
+
+enum stick_data_type
+{
+    STICK_STATE_LEFT_X,
+    STICK_STATE_LEFT_Y,
+    STICK_STATE_RIGHT_X,
+    STICK_STATE_RIGHT_Y
+};
+
+struct wheel_state
+{
+    button_state middle = STATE_RELEASED;
+    wheel_direction dir = WHEEL_DIR_NONE;
+    int amount = 0;
+};
+
+/* Mouse position, coalesced once per frame */
+struct mouse_state
+{
+    int16_t x = 0, y = 0;
+    int16_t dx = 0, dy = 0;             /* Movement during the last frame */
+};
+
+/* Both analog sticks, from -1 to 1 with y pointing down */
+struct stick_state
+{
+    vec2 left = {}, right = {};
+    button_state left_state = STATE_RELEASED, right_state = STATE_RELEASED;
+};
+
+/* Contains data for both trigger buttons */
+struct trigger_state
+{
+    float left = 0.f, right = 0.f;
+};
+
+/**
+ * Complete state of one pad, packed into 16 bytes so it can be
+ * copied around whole. Pads write it in place and publish it
+ * through a seqlock, see element_data_holder
+ */
+struct gamepad_data
+{
+    /* Gamepad key codes only use the lower byte (See PAD_TO_VC) */
+    void set_button(uint16_t keycode, button_state state);
+    bool pressed(uint16_t keycode) const;
+
+    void set_stick(const stick_state& stick);
+    void set_axis(stick_data_type axis, float value);
+    stick_state stick() const;
+
+    void set_trigger(element_side side, float value);
+    trigger_state trigger() const;
+
+    dpad_direction get_dpad() const { return static_cast<dpad_direction>(dpad); }
+
+    /* Replaces everything with a state in xinput's terms: wButtons (see PAD_BIT_*),
+     * sticks (left x, y, right x, y) from -1 to 1 with y pointing up and
+     * triggers from 0 to 1. Remote pads and evdev pads are converted to that */
+    void set_xinput(uint16_t bits, const float sticks[4], float left_trigger, float right_trigger);
+    bool operator==(const gamepad_data& other) const;
+
+    uint32_t buttons = 0;       /* One bit per PAD_* button, stick buttons included */
+    int16_t axes[4] = {};       /* stick_data_type order, y pointing down */
+    uint8_t triggers[2] = {};   /* Left, right */
+    uint8_t dpad = DPAD_CENTER; /* dpad_direction */
+    uint8_t reserved = 0;
+};
+
+static_assert(sizeof(gamepad_data) == 16, "gamepad_data has to stay packed");
+
+/**
+ * One complete copy of the input state of a source.
+ * Readers only ever see these through element_data_holder::snapshot()
+ */
+struct input_state
+{
+    bool button_pressed(uint16_t keycode) const;
+    bool gamepad_button_pressed(uint8_t pad, uint16_t keycode) const;
+    const wheel_state& get_wheel() const;
+
+    /* nullptr if pad is out of range */
+    const gamepad_data* get_gamepad(uint8_t pad) const;
+
+    bool is_empty() const;
+
+    /* Calls f(keycode) for every pressed key/mouse button */
+    template <class F>
+    void for_each_pressed(F f) const
+    {
+        if (!pressed_count)
+            return;
+
+        for (auto i = 0; i < KEY_TABLE_SIZE; i++)
+        {
+            auto word = buttons[i];
+            for (auto bit = 0; word; bit++, word >>= 1)
+            {
+                if (word & 1)
+                    f(static_cast<uint16_t>(i * 64 + bit));
+            }
+        }
+    }
+
+    uint64_t buttons[KEY_TABLE_SIZE] = {};
+    uint32_t pressed_count = 0;
+    uint32_t generation = 0; /* Increased every time a changed state is published */
+    uint64_t event_time = 0; /* Hook time of the oldest event that is new in this state, 0 if unknown */
+    wheel_state wheel;
+    mouse_state mouse;
+
+    /* Only written by snapshot(), writers never copy
+     * these (see element_data_holder::publish()) */
+    uint32_t pad_generation = 0; /* Increased every time a pad changed */
+    gamepad_data gamepads[PAD_COUNT];
+};
+
+/**
+ * Holds the current input state of one input source
+ * (local hooks or one remote client). Everything is stored in
+ * fixed size tables indexed by key code, so neither updates nor
+ * lookups allocate or walk a tree.
+ *
+ * The state is triple buffered: Writers (hook, gamepad and network
+ * threads) only touch the back buffer, publish() hands a copy of it
+ * to the reader with an atomic exchange. The reader (the graphics thread)
+ * takes the latest published buffer with snapshot() and can use it
+ * until its next call to snapshot(), so a frame never sees half an update.
+ *
+ * Pads change far more often than keys, with every bit of stick movement.
+ * Their state is small, so each pad has its own seqlock instead: Writers
+ * update it in place without taking the lock or copying the key tables
+ * around, and snapshot() copies the pads into the reader's buffer.
+ * Pad updates are visible right away, they don't need publish().
+ */
 class element_data_holder
 {
 public:
     element_data_holder();
-    ~element_data_holder();
 
-    void add_data(uint16_t keycode, element_data* data);
-    bool data_exists(uint16_t keycode);
-    void remove_data(uint16_t keycode);
-    element_data* get_by_code(uint16_t keycode);
+    /* Keyboard and mouse */
+    void set_button(uint16_t keycode, button_state state);
+    /* Presses all keys in keys. If complete is set, keys holds every
+     * pressed key and all others are released */
+    void set_pressed_keys(const uint16_t* keys, size_t count, bool complete = true);
 
-    void add_gamepad_data(uint8_t gamepad, uint16_t keycode, element_data* data);
-    bool gamepad_data_exists(uint8_t gamepad, uint16_t keycode);
-    void remove_gamepad_data(uint8_t gamepad, uint16_t keycode);
-    element_data* get_by_gamepad(uint8_t gamepad, uint16_t keycode);
+    void set_wheel_button(button_state state);
+    void set_wheel(wheel_direction dir, int amount);
+    /* Adds amount if dir is the current direction, otherwise starts over */
+    void add_wheel(wheel_direction dir, int amount);
 
-    bool is_empty() const;
-    bool m_map_cleared = false;
+    /* Only marks the state as changed if anything differs */
+    void set_mouse(const mouse_state& mouse);
 
-    std::map<uint16_t, std::unique_ptr<element_data>> m_data;
-    std::map<uint16_t, std::unique_ptr<element_data>> m_gamepad_data[4];
+    /* Gamepads */
+    /* Replaces the whole state of a pad at once */
+    void set_gamepad(uint8_t pad, const gamepad_data& data);
 
-private:
-    /* Prevent drawing thread from accessing data while
-     * hook threads write to it
+    void set_gamepad_button(uint8_t pad, uint16_t keycode, button_state state);
+
+    void set_gamepad_stick(uint8_t pad, const stick_state& stick);
+    void set_gamepad_axis(uint8_t pad, stick_data_type axis, float value);
+    void set_gamepad_stick_button(uint8_t pad, element_side side, button_state state);
+
+    void set_gamepad_trigger(uint8_t pad, float left, float right);
+    void set_gamepad_trigger(uint8_t pad, element_side side, float value);
+
+    /* Xinput directly reports both directions */
+    void set_gamepad_dpad(uint8_t pad, dpad_direction a, dpad_direction b);
+    /* Linux reports each direction as a separate button */
+    void set_gamepad_dpad(uint8_t pad, dpad_direction d, button_state state);
+
+    /* Hook time of the event the following writes come from, used
+     * for latency measurements */
+    void set_event_time(uint64_t ns);
+
+    /* Makes all writes so far visible to the reader. Does nothing if
+     * nothing changed since the last call. Can be called from any thread
+     */
+    void publish();
+
+    /* Latest published state. Only call this from the graphics thread,
+     * the returned state stays valid until the next call
      */
-    bool m_data_locked = false;
-    bool m_gamepad_data_locked = false;
+    const input_state* snapshot();
+
+    static dpad_direction merge_directions(dpad_direction a, dpad_direction b);
+private:
+    input_state& back() { return m_states[m_write]; }
+
+    /* Calls f with the pad's state to change it, f returns whether it did */
+    template <class F>
+    void update_gamepad(const uint8_t pad, F f)
+    {
+        if (pad < PAD_COUNT)
+            m_pads[pad].update(f);
+    }
+
+    input_state m_states[3];
+
+    /* Index of the buffer that was published last, SNAPSHOT_NEW is set
+     * until the reader picked it up */
+    std::atomic<uint8_t> m_middle;
+    uint8_t m_write = 0; /* Guarded by m_write_lock */
+    uint8_t m_read = 2;  /* Only touched by the reader */
+
+    std::mutex m_write_lock;
+    bool m_changed = false;
+
+    seqlock<gamepad_data> m_pads[PAD_COUNT];
+    /* Only touched by the reader */
+    uint32_t m_pad_seqs[PAD_COUNT] = {};
+    uint32_t m_pad_generation = 0;
 };
@@ -9,37 +9,6 @@
 
 #include "element_texture.hpp"
 
-enum dpad_direction;
-
-enum button_state;
-
-class element_data_dpad : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-
-    /* Xinput directly generates direction */
-    element_data_dpad(dpad_direction a, dpad_direction b);
-
-    element_data_dpad(dpad_direction d, button_state state);
-
-    bool is_persistent() override;
-
-    void merge(element_data* other) override;
-
-    static dpad_direction merge_directions(dpad_direction a, dpad_direction b);
-
-    dpad_direction get_direction() const;
-
-    button_state get_state() const;
-private:
-    dpad_direction m_direction;
-    button_state m_state;
-};
-
 class element_dpad : public element_texture
 {
 public:
@@ -47,10 +16,8 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
-
-    data_source get_source() override;
+    void draw(sprite_batch* batch, const input_state* data,
+        sources::shared_settings* settings) const;
 
 private:
     /* Center is in m_mapping */
@@ -9,7 +9,7 @@
 #include "../../../ccl/ccl.hpp"
 #include "element_gamepad_id.hpp"
 #include "util/layout_constants.hpp"
-#include "element_button.hpp"
+#include "element_data_holder.hpp"
 
 element_gamepad_id::element_gamepad_id()
     : element_texture(GAMEPAD_ID), m_mappings{}
@@ -28,29 +28,22 @@ void element_gamepad_id::load(ccl_config* cfg, const std::string& id)
     }
 }
 
-void element_gamepad_id::draw(gs_effect_t* effect,
-    gs_image_file_t* image, element_data* data, sources::shared_settings* settings)
+void element_gamepad_id::draw(sprite_batch* batch,
+    const input_state* data, sources::shared_settings* settings) const
 {
-    if (data)
+    if (data && data->gamepad_button_pressed(settings->gamepad, m_keycode))
     {
-		const auto d = dynamic_cast<element_data_button*>(data);
-        if (d && d->get_state())
-        {
-			element_texture::draw(effect, image, &m_mappings[3]);
-        }
+        element_texture::draw(batch, &m_mappings[3]);
     }
 
-    if (settings->gamepad > 0)
+    /* The ring only has four player lights, further pads start over */
+    const auto player = settings->gamepad % 4;
+    if (player > 0)
     {
-        element_texture::draw(effect, image, &m_mappings[settings->gamepad - 1]);
+        element_texture::draw(batch, &m_mappings[player - 1], 1);
     }
     else
     {
-        element_texture::draw(effect, image, &m_mapping);
+        element_texture::draw(batch, &m_mapping, 1);
     }
 }
-
-data_source element_gamepad_id::get_source()
-{
-    return GAMEPAD;
-}
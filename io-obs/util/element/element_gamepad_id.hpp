@@ -18,10 +18,10 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
+    void draw(sprite_batch* batch, const input_state* data,
+        sources::shared_settings* settings) const;
 
-    data_source get_source() override;
+    uint8_t quad_count() const override { return 2; }
 
 private:
     /* 0 - 2 Player 2 - 4 (Player 1 is default)
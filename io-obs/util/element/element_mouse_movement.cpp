@@ -15,25 +15,6 @@ void element_mouse_movement::load(ccl_config* cfg, const std::string& id)
     element_texture::load(cfg, id);
 }
 
-void element_mouse_movement::draw(gs_effect_t* effect,
-    gs_image_file_t* image, element_data* data, sources::shared_settings* settings)
-{
-}
-
-element_data_mouse_movement::element_data_mouse_movement()
-    : element_data(TRIGGER)
-{
-}
-
-bool element_data_mouse_movement::is_persistent()
-{
-    return true;
-}
-
-void element_data_mouse_movement::merge(element_data* other)
-{
-}
-
 element_mouse_movement::element_mouse_movement()
     : element_texture(BUTTON)
 {
@@ -9,24 +9,6 @@
 
 #include "element_texture.hpp"
 
-/* Contains data for both trigger buttons
- */
-class element_data_mouse_movement : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-    element_data_mouse_movement();
-
-    bool is_persistent() override;
-
-    void merge(element_data* other) override;
-
-private:
-};
-
 class element_mouse_movement : public element_texture
 {
 public:
@@ -34,10 +16,8 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
-
-    data_source get_source() override { return MOUSE_POS; }
+    /* Not drawn yet */
+    uint8_t quad_count() const override { return 0; }
 
 private:
 };
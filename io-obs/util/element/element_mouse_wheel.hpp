@@ -13,51 +13,16 @@
 #define WHEEL_MAP_UP      1
 #define WHEEL_MAP_DOWN    2
 
-enum wheel_data_type
-{
-    BUTTON_STATE,
-    WHEEL_STATE
-};
-
-enum wheel_direction;
-
-enum button_state;
-
-class element_data_wheel : public element_data
-{
-public:
-    element_data_wheel(wheel_direction dir, int amount);
-
-    element_data_wheel(button_state state);
-
-    int get_amount() const;
-
-    wheel_direction get_dir() const;
-
-    void set_dir(wheel_direction dir);
-
-    button_state get_state() const;
-
-    bool is_persistent() override;
-
-    void merge(element_data* other) override;
-private:
-    wheel_data_type m_data_type;
-    button_state m_middle_button;
-    wheel_direction m_dir;
-    int m_amount = 0;
-};
-
 class element_wheel : public element_texture
 {
 public:
     element_wheel();
 
     void load(ccl_config* cfg, const std::string& id) override;
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
+    void draw(sprite_batch* batch, const input_state* data,
+        sources::shared_settings* settings) const;
 
-    data_source get_source() override;
+    uint8_t quad_count() const override { return 3; }
 private:
     /* Middle, Up, Down */
     gs_rect m_mappings[3];
@@ -14,30 +14,6 @@ void element_text::load(ccl_config* cfg, const std::string& id)
 {
 }
 
-void element_text::draw(gs_effect_t* effect,
-    gs_image_file_t* image, element_data* data, sources::shared_settings* settings)
-{
-}
-
-data_source element_text::get_source()
-{
-    return DEFAULT;
-}
-
-element_data_text::element_data_text()
-    : element_data(TRIGGER)
-{
-}
-
-bool element_data_text::is_persistent()
-{
-    return true;
-}
-
-void element_data_text::merge(element_data* other)
-{
-}
-
 element_text::element_text()
     : element(TEXT)
 {
@@ -8,24 +8,6 @@
 #pragma once
 #include "element_texture.hpp"
 
-/* Contains data for both trigger buttons
- */
-class element_data_text : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-    element_data_text();
-
-    bool is_persistent() override;
-
-    void merge(element_data* other) override;
-
-private:
-};
-
 class element_text : public element
 {
 public:
@@ -33,10 +15,8 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
-
-    data_source get_source() override;
+    /* Not drawn yet */
+    uint8_t quad_count() const override { return 0; }
 
 private:
 };
@@ -9,6 +9,7 @@
 #include "element_texture.hpp"
 #include "../../../ccl/ccl.hpp"
 #include "util/layout_constants.hpp"
+#include "util/sprite_batch.hpp"
 
 extern "C" {
 #include <graphics/image-file.h>
@@ -32,31 +33,19 @@ void element_texture::load(ccl_config* cfg, const std::string& id)
     read_mapping(cfg, id);
 }
 
-void element_texture::draw(gs_effect_t* effect, gs_image_file_t* image,
-    element_data* data, sources::shared_settings* settings)
+void element_texture::draw(sprite_batch* batch, const input_state* data,
+    sources::shared_settings* settings) const
 {
-    draw(effect, image, &m_mapping, &m_pos);
+    draw(batch, &m_mapping, &m_pos);
 }
 
-void element_texture::draw(gs_effect_t* effect, gs_image_file_t* image,
-    const gs_rect* rect) const
+void element_texture::draw(sprite_batch* batch, const gs_rect* rect, const uint8_t quad) const
 {
-    draw(effect, image, rect ? rect : &m_mapping, &m_pos);
+    draw(batch, rect ? rect : &m_mapping, &m_pos, quad);
 }
 
-void element_texture::draw(gs_effect_t* effect, gs_image_file_t* image,
-    const gs_rect* rect, const vec2* pos)
+void element_texture::draw(sprite_batch* batch, const gs_rect* rect, const vec2* pos,
+    const uint8_t quad) const
 {
-    gs_matrix_push();
-    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
-        image->texture);
-    gs_matrix_translate3f(pos->x, pos->y, 1.f);
-    gs_draw_sprite_subregion(image->texture, 0, rect->x, rect->y, rect->cx,
-        rect->cy);
-    gs_matrix_pop();
-}
-
-data_source element_texture::get_source()
-{
-    return GAMEPAD;
+    batch->set(m_slot + quad, rect, pos);
 }
@@ -18,12 +18,12 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        const gs_rect* rect) const;
-    static void draw(gs_effect_t* effect, gs_image_file_t* image,
-        const gs_rect* rect, const vec2* pos);
-
-    data_source get_source() override;
+    /* Not virtual, the overlay always calls this on the concrete type.
+     * data is nullptr if there's no input source */
+    void draw(sprite_batch* batch, const input_state* data,
+        sources::shared_settings* settings) const;
+protected:
+    /* quad is the index of the slot, relative to this elements first slot */
+    void draw(sprite_batch* batch, const gs_rect* rect, uint8_t quad = 0) const;
+    void draw(sprite_batch* batch, const gs_rect* rect, const vec2* pos, uint8_t quad = 0) const;
 };
@@ -8,6 +8,7 @@
 #include "../../sources/input_source.hpp"
 #include "../../../ccl/ccl.hpp"
 #include "element_trigger.hpp"
+#include "element_data_holder.hpp"
 #include "../util.hpp"
 #include "util/layout_constants.hpp"
 
@@ -31,58 +32,51 @@ void element_trigger::load(ccl_config* cfg, const std::string& id)
     }
 }
 
-void element_trigger::draw(gs_effect_t* effect,
-    gs_image_file_t* image, element_data* data, sources::shared_settings* settings)
+void element_trigger::draw(sprite_batch* batch,
+    const input_state* data, sources::shared_settings* settings) const
 {
-    if (data)
+    const auto pad = data ? data->get_gamepad(settings->gamepad) : nullptr;
+
+    if (pad)
     {
-        const auto trigger = dynamic_cast<element_data_trigger*>(data);
         auto progress = 0.f;
-        if (trigger)
+        switch (m_side)
         {
-            switch (m_side)
-            {
-            case SIDE_LEFT:
-                progress = trigger->get_left();
-                break;
-            case SIDE_RIGHT:
-                progress = trigger->get_right();
-                break;
-            default: ;
-            }
+        case SIDE_LEFT:
+            progress = pad->trigger().left;
+            break;
+        case SIDE_RIGHT:
+            progress = pad->trigger().right;
+            break;
+        default: ;
+        }
 
-            if (m_button_mode)
+        if (m_button_mode)
+        {
+            if (progress >= 0.1)
             {
-                if (progress >= 0.1)
-                {
-                    element_texture::draw(effect, image, &m_pressed);
-                }
-                else
-                {
-                    element_texture::draw(effect, image, &m_mapping);
-                }
+                element_texture::draw(batch, &m_pressed);
             }
             else
             {
-                auto crop = m_pressed;
-                auto new_pos = m_pos;
-                calculate_mapping(&crop, &new_pos, progress);
-                element_texture::draw(effect, image, &m_mapping); /* Draw unpressed first */
-                element_texture::draw(effect, image, &crop, &new_pos);
+                element_texture::draw(batch, &m_mapping);
             }
         }
+        else
+        {
+            auto crop = m_pressed;
+            auto new_pos = m_pos;
+            calculate_mapping(&crop, &new_pos, progress);
+            element_texture::draw(batch, &m_mapping); /* Draw unpressed first */
+            element_texture::draw(batch, &crop, &new_pos, 1);
+        }
     }
     else
     {
-        element_texture::draw(effect, image, nullptr);
+        element_texture::draw(batch, nullptr);
     }
 }
 
-data_source element_trigger::get_source()
-{
-    return GAMEPAD;
-}
-
 void element_trigger::calculate_mapping(gs_rect* pressed, vec2* pos, const float progress) const
 {
     switch (m_direction)
@@ -106,62 +100,3 @@ void element_trigger::calculate_mapping(gs_rect* pressed, vec2* pos, const float
     default: ;
     }
 }
-
-element_data_trigger::element_data_trigger(const trigger_data_type side, const float val)
-    : element_data(TRIGGER)
-{
-    if (side == T_DATA_LEFT)
-        m_left_trigger = val;
-    else
-        m_right_trigger = val;
-    m_data_type = side;
-}
-
-element_data_trigger::element_data_trigger(const float left, const float right)
-    : element_data(TRIGGER)
-{
-    m_left_trigger = left;
-    m_right_trigger = right;
-    m_data_type = T_DATA_BOTH;
-}
-
-float element_data_trigger::get_left() const
-{
-    return m_left_trigger;
-}
-
-float element_data_trigger::get_right() const
-{
-    return m_right_trigger;
-}
-
-bool element_data_trigger::is_persistent()
-{
-    return true;
-}
-
-void element_data_trigger::merge(element_data* other)
-{
-    if (other && other->get_type() == m_type)
-    {
-        const auto trigger = dynamic_cast<element_data_trigger*>(other);
-
-        if (trigger)
-        {
-            switch (trigger->m_data_type)
-            {
-            case T_DATA_BOTH:
-                m_left_trigger = trigger->m_left_trigger;
-                m_right_trigger = trigger->m_right_trigger;
-                break;
-            case T_DATA_LEFT:
-                m_left_trigger = trigger->m_left_trigger;
-                break;
-            case T_DATA_RIGHT:
-                m_right_trigger = trigger->m_right_trigger;
-                break;
-            default: ;
-            }
-        }
-    }
-}
@@ -9,44 +9,10 @@
 
 #include "element_texture.hpp"
 
-enum trigger_data_type
-{
-    T_DATA_NONE = -1,
-    T_DATA_BOTH,
-    T_DATA_LEFT,
-    T_DATA_RIGHT
-};
-
 enum trigger_direction;
 
 enum element_side;
 
-/* Contains data for both trigger buttons
- */
-class element_data_trigger : public element_data
-{
-public:
-    /*
-        Separate constructors are used on linux
-        because the values can't be queried together
-    */
-    element_data_trigger(trigger_data_type side, float val);
-
-    element_data_trigger(float left, float right);
-
-    float get_left() const;
-
-    float get_right() const;
-
-    bool is_persistent() override;
-
-    void merge(element_data* other) override;
-
-private:
-    trigger_data_type m_data_type = T_DATA_NONE;
-    float m_left_trigger = 0.f, m_right_trigger = 0.f;
-};
-
 class element_trigger : public element_texture
 {
 public:
@@ -54,10 +20,10 @@ public:
 
     void load(ccl_config* cfg, const std::string& id) override;
 
-    void draw(gs_effect_t* effect, gs_image_file_t* image,
-        element_data* data, sources::shared_settings* settings) override;
+    void draw(sprite_batch* batch, const input_state* data,
+        sources::shared_settings* settings) const;
 
-    data_source get_source() override;
+    uint8_t quad_count() const override { return 2; }
 
 private:
     void calculate_mapping(gs_rect* pressed, vec2* pos, float progress) const;
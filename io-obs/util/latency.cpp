@@ -0,0 +1,141 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "latency.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <util/platform.h>
+
+/* Index of the highest set bit, v has to be > 0 */
+static uint32_t highest_bit(uint64_t v)
+{
+    uint32_t r = 0;
+    if (v >> 32) { v >>= 32; r += 32; }
+    if (v >> 16) { v >>= 16; r += 16; }
+    if (v >> 8) { v >>= 8; r += 8; }
+    if (v >> 4) { v >>= 4; r += 4; }
+    if (v >> 2) { v >>= 2; r += 2; }
+    if (v >> 1) r += 1;
+    return r;
+}
+
+latency_histogram::latency_histogram()
+{
+    reset();
+}
+
+void latency_histogram::record(const uint64_t ns)
+{
+    m_buckets[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+uint64_t latency_histogram::percentile(const double p) const
+{
+    const auto total = count();
+    if (!total)
+        return 0;
+
+    auto target = static_cast<uint64_t>(total * p / 100.0 + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return std::min(upper_bound(i), max());
+    }
+    return max();
+}
+
+uint64_t latency_histogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+void latency_histogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint32_t latency_histogram::index_of(const uint64_t ns)
+{
+    if (ns < LATENCY_LINEAR_LIMIT)
+        return static_cast<uint32_t>(ns);
+
+    /* Top bit selects the power of two, next four bits the sub bucket */
+    const auto bit = highest_bit(ns);
+    const auto sub = static_cast<uint32_t>(ns >> (bit - 4)) & (LATENCY_SUB_BUCKETS - 1);
+    return LATENCY_LINEAR_LIMIT + (bit - 5) * LATENCY_SUB_BUCKETS + sub;
+}
+
+uint64_t latency_histogram::upper_bound(const uint32_t index)
+{
+    if (index < LATENCY_LINEAR_LIMIT)
+        return index;
+
+    const auto bit = (index - LATENCY_LINEAR_LIMIT) / LATENCY_SUB_BUCKETS + 5;
+    const auto sub = (index - LATENCY_LINEAR_LIMIT) % LATENCY_SUB_BUCKETS;
+    const auto width = uint64_t(1) << (bit - 4);
+    return (LATENCY_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+namespace latency
+{
+    latency_histogram histograms[STAGE_COUNT];
+
+    static const char* stage_names[STAGE_COUNT] = {
+        "Hook -> queue drain",
+        "Hook -> publish",
+        "Hook -> overlay draw"
+    };
+
+    void record(const stage s, const uint64_t start_ns)
+    {
+        const auto now = os_gettime_ns();
+        if (start_ns && now >= start_ns)
+            histograms[s].record(now - start_ns);
+    }
+
+    std::string summary()
+    {
+        std::string result;
+        char line[256];
+
+        for (auto i = 0; i < STAGE_COUNT; i++)
+        {
+            const auto& h = histograms[i];
+            snprintf(line, sizeof(line),
+                "%-22s n=%-9llu p50=%8.3fms p99=%8.3fms p99.9=%8.3fms max=%8.3fms\n",
+                stage_names[i], static_cast<unsigned long long>(h.count()),
+                h.percentile(50.0) / 1e6, h.percentile(99.0) / 1e6,
+                h.percentile(99.9) / 1e6, h.max() / 1e6);
+            result.append(line);
+        }
+        return result;
+    }
+
+    void reset()
+    {
+        for (auto& h : histograms)
+            h.reset();
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/* Values below this are counted exactly, above it every power of two
+ * is split into 16 buckets, so a bucket is at most 6.25% wide */
+#define LATENCY_LINEAR_LIMIT    32
+#define LATENCY_SUB_BUCKETS     16
+#define LATENCY_BUCKETS         (LATENCY_LINEAR_LIMIT + (64 - 5) * LATENCY_SUB_BUCKETS)
+
+/**
+ * Log-linear (HDR style) histogram of nanosecond durations.
+ * record() is lock-free and can be called from any thread,
+ * reading while recording only gives a slightly stale result.
+ */
+class latency_histogram
+{
+public:
+    latency_histogram();
+
+    void record(uint64_t ns);
+
+    /* Upper bound of the bucket holding the given percentile (0 - 100) */
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const;
+    uint64_t max() const;
+
+    void reset();
+private:
+    static uint32_t index_of(uint64_t ns);
+    static uint64_t upper_bound(uint32_t index);
+
+    std::atomic<uint32_t> m_buckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_max;
+};
+
+namespace latency
+{
+    /* All stages are measured from the moment the hook received the event */
+    enum stage
+    {
+        STAGE_QUEUE,    /* Until the graphics thread took it out of the event queue */
+        STAGE_PUBLISH,  /* Until it was published to the sources */
+        STAGE_DRAW,     /* Until an overlay redrew with it */
+        STAGE_COUNT
+    };
+
+    extern latency_histogram histograms[STAGE_COUNT];
+
+    /* Records the time from start_ns (os_gettime_ns) until now */
+    void record(stage s, uint64_t start_ns);
+
+    /* p50/p99/p99.9/max of each stage, one line per stage */
+    std::string summary();
+
+    void reset();
+}
@@ -0,0 +1,86 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "mouse_coalescer.hpp"
+
+/* Layout of mouse_coalescer::m_state */
+#define PACK(v, shift)      (static_cast<uint64_t>(static_cast<uint16_t>(v)) << (shift))
+#define UNPACK(s, shift)    static_cast<int16_t>(static_cast<uint16_t>((s) >> (shift)))
+#define SHIFT_X     0
+#define SHIFT_Y     16
+#define SHIFT_DX    32
+#define SHIFT_DY    48
+
+/* x of the initial state, before the first move. No screen is that far
+ * off, so move() clamps real positions to INT16_MIN + 1 */
+#define NO_POSITION INT16_MIN
+
+static int16_t saturate(const int32_t v)
+{
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    if (v < INT16_MIN + 1)
+        return INT16_MIN + 1;
+    return static_cast<int16_t>(v);
+}
+
+static uint64_t pack(const int16_t x, const int16_t y, const int16_t dx, const int16_t dy)
+{
+    return PACK(x, SHIFT_X) | PACK(y, SHIFT_Y) | PACK(dx, SHIFT_DX) | PACK(dy, SHIFT_DY);
+}
+
+/* mouse_coalescer */
+
+mouse_coalescer::mouse_coalescer()
+    : m_state(pack(NO_POSITION, 0, 0, 0))
+{
+}
+
+void mouse_coalescer::move(int16_t x, const int16_t y)
+{
+    auto old = m_state.load(std::memory_order_relaxed);
+    uint64_t state;
+
+    if (x == NO_POSITION)
+        x++;
+
+    do
+    {
+        const auto last_x = UNPACK(old, SHIFT_X);
+        auto dx = UNPACK(old, SHIFT_DX), dy = UNPACK(old, SHIFT_DY);
+
+        /* The first move has nothing to compare against */
+        if (last_x != NO_POSITION)
+        {
+            dx = saturate(dx + x - last_x);
+            dy = saturate(dy + y - UNPACK(old, SHIFT_Y));
+        }
+        state = pack(x, y, dx, dy);
+    }
+    while (!m_state.compare_exchange_weak(old, state, std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+mouse_sample mouse_coalescer::take()
+{
+    auto old = m_state.load(std::memory_order_acquire);
+    mouse_sample sample;
+
+    do
+    {
+        sample.x = UNPACK(old, SHIFT_X);
+        if (sample.x == NO_POSITION)
+            return mouse_sample();
+        sample.y = UNPACK(old, SHIFT_Y);
+        sample.dx = UNPACK(old, SHIFT_DX);
+        sample.dy = UNPACK(old, SHIFT_DY);
+        sample.valid = true;
+    }
+    while (!m_state.compare_exchange_weak(old, pack(sample.x, sample.y, 0, 0),
+        std::memory_order_acquire, std::memory_order_acquire));
+    return sample;
+}
@@ -0,0 +1,40 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/* Latest mouse position and the movement since the last take() */
+struct mouse_sample
+{
+    int16_t x = 0, y = 0;
+    int16_t dx = 0, dy = 0;
+    bool valid = false; /* False until the mouse moved once */
+};
+
+/**
+ * Collapses any number of mouse move events into one sample.
+ * The hook thread calls move() for every event, the graphics thread
+ * calls take() once per frame. Position and accumulated movement are
+ * packed into one 64 bit word, so both sides only ever do a
+ * compare-exchange and there's no queue to overflow.
+ */
+class mouse_coalescer
+{
+public:
+    mouse_coalescer();
+
+    /* Producer side */
+    void move(int16_t x, int16_t y);
+
+    /* Consumer side, resets the accumulated movement */
+    mouse_sample take();
+private:
+    std::atomic<uint64_t> m_state;
+};
@@ -17,11 +17,11 @@
 #include "../sources/input_source.hpp"
 #include "element/element_gamepad_id.hpp"
 #include "element/element_dpad.hpp"
-#include "network/remote_connection.hpp"
-#include "network/io_server.hpp"
+#include "latency.hpp"
 
 extern "C" {
 #include <graphics/image-file.h>
+#include <graphics/vec4.h>
 }
 
 namespace sources
@@ -65,6 +65,17 @@ void overlay::unload()
 {
     unload_texture();
     unload_elements();
+
+    if (m_cache)
+    {
+        obs_enter_graphics();
+        gs_texrender_destroy(m_cache);
+        obs_leave_graphics();
+        m_cache = nullptr;
+    }
+    m_cache_valid = false;
+    m_cache_failed = false;
+
     m_settings->gamepad = 0;
     m_settings->cx = 100;
     m_settings->cy = 100;
@@ -157,77 +168,145 @@ void overlay::unload_texture() const
 
 void overlay::unload_elements()
 {
-    m_elements.clear();
+    m_buttons.clear();
+    m_textures.clear();
+    m_wheels.clear();
+    m_triggers.clear();
+    m_sticks.clear();
+    m_gamepad_ids.clear();
+    m_dpads.clear();
+    m_quad_count = 0;
 }
 
-void overlay::draw(gs_effect_t* effect)
+void overlay::draw(gs_effect_t* effect, element_data_holder* source)
 {
     if (m_is_loaded)
     {
-        for (auto const& element : m_elements)
+        /* Same snapshot for all elements, so they can't disagree */
+        const auto state = source ? source->snapshot() : nullptr;
+        const auto generation = state ? state->generation : 0;
+        const auto pad_generation = state ? state->pad_generation : 0;
+
+        if (!m_cache_valid || source != m_cached_source || generation != m_cached_generation ||
+            pad_generation != m_cached_pad_generation || m_settings->gamepad != m_cached_gamepad)
         {
-            element_data* data = nullptr;
-            if (hook::data_initialized || network::network_flag)
+            if (state && generation != m_cached_generation)
+                latency::record(latency::STAGE_DRAW, state->event_time);
+
+            /* It would fail again every frame, so it's not retried */
+            if (!m_cache_failed)
             {
-				element_data_holder* source = nullptr;
-
-                if (m_settings->selected_source == 0)
-                {
-                    source = hook::input_data;
-                }
-                else if (network::server_instance)
-                {
-                    source = network::server_instance->
-                             get_client(m_settings->selected_source - 1)->get_data();
-                }
-
-                if (source)
-                {
-					switch (element->get_source())
-					{
-					case GAMEPAD:
-						data = source->get_by_gamepad(m_settings->gamepad,
-							element->get_keycode());
-						break;
-					case DEFAULT:
-						data = source->get_by_code(element->get_keycode());
-						break;
-					default:;
-					}
-                }
+                m_cache_valid = compose(effect, state);
+                m_cache_failed = !m_cache_valid;
             }
+            m_cached_source = source;
+            m_cached_generation = generation;
+            m_cached_pad_generation = pad_generation;
+            m_cached_gamepad = m_settings->gamepad;
+        }
 
-            element->draw(effect, m_image, data, m_settings);
+        if (m_cache_valid)
+        {
+            /* Cache contains premultiplied alpha */
+            gs_blend_state_push();
+            gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+            const auto tex = gs_texrender_get_texture(m_cache);
+            gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), tex);
+            gs_draw_sprite(tex, 0, m_settings->cx, m_settings->cy);
+            gs_blend_state_pop();
+        }
+        else
+        {
+            /* Draw directly if the render target isn't available */
+            draw_elements(state);
+            m_batch.draw(effect);
         }
     }
 }
 
+void overlay::draw_elements(const input_state* state)
+{
+    m_batch.begin(m_image, m_quad_count);
+    m_buttons.draw(&m_batch, state, m_settings);
+
+    for (const auto& e : m_textures)
+        e.draw(&m_batch, state, m_settings);
+    for (const auto& e : m_wheels)
+        e.draw(&m_batch, state, m_settings);
+    for (const auto& e : m_triggers)
+        e.draw(&m_batch, state, m_settings);
+    for (const auto& e : m_sticks)
+        e.draw(&m_batch, state, m_settings);
+    for (const auto& e : m_gamepad_ids)
+        e.draw(&m_batch, state, m_settings);
+    for (const auto& e : m_dpads)
+        e.draw(&m_batch, state, m_settings);
+}
+
+bool overlay::compose(gs_effect_t* effect, const input_state* state)
+{
+    if (!m_cache)
+        m_cache = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+    gs_texrender_reset(m_cache);
+    if (!m_cache || !gs_texrender_begin(m_cache, m_settings->cx, m_settings->cy))
+        return false;
+
+    struct vec4 clear;
+    vec4_zero(&clear);
+
+    gs_clear(GS_CLEAR_COLOR, &clear, 0.f, 0);
+    gs_ortho(0.f, float(m_settings->cx), 0.f, float(m_settings->cy), -100.f, 100.f);
+
+    gs_blend_state_push();
+    gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA,
+        GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+    draw_elements(state);
+    m_batch.draw(effect);
+
+    gs_blend_state_pop();
+    gs_texrender_end(m_cache);
+    return true;
+}
+
+template <class T>
+static element* load_into(std::vector<T>& v, ccl_config* cfg, const std::string& id)
+{
+    v.emplace_back();
+    v.back().load(cfg, id);
+    return &v.back();
+}
+
 void overlay::load_element(ccl_config* cfg, const std::string& id, const bool debug)
 {
     const auto type = cfg->get_int(id + CFG_TYPE);
     element* new_element = nullptr;
+    element_button button;
+
     switch (type)
     {
     case TEXTURE:
-        new_element = new element_texture();
+        new_element = load_into(m_textures, cfg, id);
         break;
     case BUTTON:
-        new_element = new element_button();
+        button.load(cfg, id);
+        new_element = &button;
         break;
     case MOUSE_SCROLLWHEEL:
-        new_element = new element_wheel();
+        new_element = load_into(m_wheels, cfg, id);
         break;
     case TRIGGER:
-        new_element = new element_trigger();
+        new_element = load_into(m_triggers, cfg, id);
         break;
     case ANALOG_STICK:
-        new_element = new element_analog_stick();
+        new_element = load_into(m_sticks, cfg, id);
         break;
     case GAMEPAD_ID:
-        new_element = new element_gamepad_id();
+        new_element = load_into(m_gamepad_ids, cfg, id);
         break;
     case DPAD_STICK:
-        new_element = new element_dpad();
+        new_element = load_into(m_dpads, cfg, id);
         break;
     default:
         if (debug)
@@ -237,8 +316,11 @@ void overlay::load_element(ccl_config* cfg, const std::string& id, const bool de
 
     if (new_element)
     {
-        new_element->load(cfg, id);
-        m_elements.emplace_back(new_element);
+        new_element->set_slot(m_quad_count);
+        m_quad_count += new_element->quad_count();
+
+        if (type == BUTTON)
+            m_buttons.add(button);
 
 #ifndef _DEBUG
         if (debug)
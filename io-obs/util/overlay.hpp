@@ -13,11 +13,20 @@
 #include <memory>
 #include <vector>
 #include "element/element.hpp"
+#include "element/element_button.hpp"
+#include "element/element_mouse_wheel.hpp"
+#include "element/element_trigger.hpp"
+#include "element/element_analog_stick.hpp"
+#include "element/element_gamepad_id.hpp"
+#include "element/element_dpad.hpp"
+#include "sprite_batch.hpp"
 
 #include "../hook/hook_helper.hpp"
 
 class ccl_config;
 
+class element_data_holder;
+
 typedef struct gs_image_file gs_image_file_t;
 
 //namespace Data {
@@ -35,7 +44,8 @@ public:
 
     void unload();
 
-    void draw(gs_effect_t* effect);
+    /* source can be nullptr, elements are drawn released then */
+    void draw(gs_effect_t* effect, element_data_holder* source);
 
     bool is_loaded() const
     {
@@ -61,7 +71,30 @@ private:
     sources::shared_settings* m_settings = nullptr;
 
     bool m_is_loaded = false;
-    std::vector<std::unique_ptr<element>> m_elements;
+    /* Elements grouped by type, so drawing doesn't need any virtual
+     * calls. Draw order is kept through the batch slot each element
+     * got assigned while loading */
+    button_table m_buttons;
+    std::vector<element_texture> m_textures;
+    std::vector<element_wheel> m_wheels;
+    std::vector<element_trigger> m_triggers;
+    std::vector<element_analog_stick> m_sticks;
+    std::vector<element_gamepad_id> m_gamepad_ids;
+    std::vector<element_dpad> m_dpads;
+    uint32_t m_quad_count = 0;
+
+    sprite_batch m_batch; /* All elements are drawn in one go */
+    void draw_elements(const input_state* state);
+
+    /* Elements are only redrawn into m_cache if the input changed */
+    bool compose(gs_effect_t* effect, const input_state* state);
+    gs_texrender_t* m_cache = nullptr;
+    bool m_cache_valid = false;
+    bool m_cache_failed = false; /* Render target not available, drawn directly until reload */
+    const element_data_holder* m_cached_source = nullptr;
+    uint32_t m_cached_generation = 0;
+    uint32_t m_cached_pad_generation = 0;
+    uint8_t m_cached_gamepad = 0;
 
     uint16_t m_track_radius{};
     uint16_t m_max_mouse_movement{};
@@ -0,0 +1,117 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/**
+ * Small value that's written by any thread and read without locking.
+ * Writers make the sequence odd while they change the value, readers
+ * copy the value and try again if the sequence was odd or changed
+ * meanwhile. The value is stored as atomic words, so a reader that
+ * races with a writer gets a torn copy it throws away, never undefined
+ * behaviour. Writers exclude each other through the sequence, which
+ * only spins if two of them update at the very same time.
+ * T has to be trivially copyable and a multiple of 8 bytes in size.
+ */
+template <class T>
+class seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock value must be trivially copyable");
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0, "seqlock value size must be a multiple of 8");
+
+    static const size_t WORDS = sizeof(T) / sizeof(uint64_t);
+public:
+    seqlock()
+    {
+        store(T());
+    }
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    /* Calls f with the current value to change it in place. f returns
+     * false if it didn't change anything, readers aren't bothered then.
+     * Returns what f returned */
+    template <class F>
+    bool update(F f)
+    {
+        const auto seq = lock();
+        auto value = load();
+        const bool changed = f(value);
+
+        if (changed)
+            store(value);
+        /* An unchanged value keeps its sequence */
+        m_seq.store(changed ? seq + 2 : seq, std::memory_order_release);
+        return changed;
+    }
+
+    /* Copies the value, returns its sequence. The sequence only
+     * changes if the value did, so readers can skip old values */
+    uint32_t read(T& value) const
+    {
+        for (;;)
+        {
+            const auto seq = m_seq.load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            value = load();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == seq)
+                return seq;
+        }
+    }
+private:
+    uint32_t lock()
+    {
+        for (;;)
+        {
+            auto seq = m_seq.load(std::memory_order_relaxed);
+            if (!(seq & 1) && m_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                std::memory_order_relaxed))
+            {
+                /* Readers that see the new words also see the odd sequence */
+                std::atomic_thread_fence(std::memory_order_release);
+                return seq;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    T load() const
+    {
+        uint64_t words[WORDS];
+        T value;
+
+        for (size_t i = 0; i < WORDS; i++)
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    void store(const T& value)
+    {
+        uint64_t words[WORDS];
+
+        memcpy(words, &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; i++)
+            m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<uint64_t> m_words[WORDS];
+};
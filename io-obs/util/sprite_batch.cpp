@@ -0,0 +1,127 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#include "sprite_batch.hpp"
+#include <cstring>
+#include <obs-module.h>
+#include <util/bmem.h>
+
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+/* Two triangles per quad, no index buffer */
+#define VERTS_PER_QUAD  6
+#define MIN_QUADS       64
+
+sprite_batch::~sprite_batch()
+{
+    destroy();
+}
+
+void sprite_batch::begin(gs_image_file_t* image, const uint32_t slots)
+{
+    m_image = image;
+    m_count = 0;
+
+    if (!m_image || !m_image->cx || !m_image->cy)
+        return;
+
+    m_inv_cx = 1.f / m_image->cx;
+    m_inv_cy = 1.f / m_image->cy;
+
+    if (slots > m_capacity && !reserve(slots))
+        return;
+
+    /* Zero area triangles for slots that won't be set */
+    memset(m_points, 0, sizeof(struct vec3) * slots * VERTS_PER_QUAD);
+    m_count = slots;
+}
+
+void sprite_batch::set(const uint32_t slot, const gs_rect* rect, const vec2* pos)
+{
+    if (slot >= m_count)
+        return;
+
+    const auto x0 = pos->x, y0 = pos->y;
+    const auto x1 = x0 + rect->cx, y1 = y0 + rect->cy;
+    const auto u0 = rect->x * m_inv_cx, v0 = rect->y * m_inv_cy;
+    const auto u1 = (rect->x + rect->cx) * m_inv_cx;
+    const auto v1 = (rect->y + rect->cy) * m_inv_cy;
+
+    auto p = m_points + slot * VERTS_PER_QUAD;
+    auto t = m_uvs + slot * VERTS_PER_QUAD;
+
+    vec3_set(p++, x0, y0, 0.f); vec2_set(t++, u0, v0);
+    vec3_set(p++, x1, y0, 0.f); vec2_set(t++, u1, v0);
+    vec3_set(p++, x0, y1, 0.f); vec2_set(t++, u0, v1);
+    vec3_set(p++, x0, y1, 0.f); vec2_set(t++, u0, v1);
+    vec3_set(p++, x1, y0, 0.f); vec2_set(t++, u1, v0);
+    vec3_set(p, x1, y1, 0.f);   vec2_set(t, u1, v1);
+}
+
+void sprite_batch::draw(gs_effect_t* effect)
+{
+    if (!m_count || !m_vb || !m_image || !m_image->texture)
+        return;
+
+    gs_vertexbuffer_flush(m_vb);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
+        m_image->texture);
+    gs_load_vertexbuffer(m_vb);
+    gs_load_indexbuffer(nullptr);
+    gs_draw(GS_TRIS, 0, m_count * VERTS_PER_QUAD);
+}
+
+void sprite_batch::destroy()
+{
+    if (m_vb)
+    {
+        obs_enter_graphics();
+        gs_vertexbuffer_destroy(m_vb);
+        obs_leave_graphics();
+    }
+
+    m_vb = nullptr;
+    m_points = nullptr;
+    m_uvs = nullptr;
+    m_capacity = 0;
+    m_count = 0;
+}
+
+bool sprite_batch::reserve(const uint32_t quads)
+{
+    auto capacity = m_capacity ? m_capacity : MIN_QUADS;
+    while (capacity < quads)
+        capacity *= 2;
+
+    const auto num = capacity * VERTS_PER_QUAD;
+    auto vbd = gs_vbdata_create();
+    vbd->num = num;
+    vbd->points = static_cast<struct vec3*>(bzalloc(sizeof(struct vec3) * num));
+    vbd->num_tex = 1;
+    vbd->tvarray = static_cast<struct gs_tvertarray*>(bzalloc(sizeof(struct gs_tvertarray)));
+    vbd->tvarray[0].width = 2;
+    vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * num);
+
+    const auto vb = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+    if (!vb)
+    {
+        blog(LOG_ERROR, "[input-overlay] Failed to create sprite batch for %u quads", capacity);
+        return false;
+    }
+
+    if (m_vb)
+        gs_vertexbuffer_destroy(m_vb);
+
+    const auto data = gs_vertexbuffer_get_data(vb);
+    m_vb = vb;
+    m_points = data->points;
+    m_uvs = static_cast<struct vec2*>(data->tvarray[0].array);
+    m_capacity = capacity;
+    return true;
+}
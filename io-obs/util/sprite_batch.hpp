@@ -0,0 +1,62 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "graphics/vec2.h"
+#include "graphics/graphics.h"
+
+typedef struct gs_image_file gs_image_file_t;
+
+/**
+ * Collects textured quads that all sample the same atlas
+ * and submits them with a single draw call.
+ * Every element owns fixed slots in the batch (assigned in layout order),
+ * so elements can be filled in any order without changing what's on top.
+ * Slots that aren't set in a frame stay empty.
+ * The vertex buffer is kept between frames and only
+ * recreated if a frame needs more quads than it can hold.
+ * Everything except set() needs the graphics context.
+ */
+class sprite_batch
+{
+public:
+    sprite_batch() = default;
+    ~sprite_batch();
+
+    sprite_batch(const sprite_batch&) = delete;
+    sprite_batch& operator=(const sprite_batch&) = delete;
+
+    /* Starts a new frame with the given amount of empty slots,
+     * all quads will be taken from image */
+    void begin(gs_image_file_t* image, uint32_t slots);
+
+    /* Draws the region rect of the atlas at pos in the given slot */
+    void set(uint32_t slot, const gs_rect* rect, const vec2* pos);
+
+    /* Uploads and draws all slots */
+    void draw(gs_effect_t* effect);
+
+    void destroy();
+
+    uint32_t count() const
+    {
+        return m_count;
+    }
+
+private:
+    bool reserve(uint32_t quads);
+
+    gs_image_file_t* m_image = nullptr;
+    float m_inv_cx = 0.f, m_inv_cy = 0.f;
+    gs_vertbuffer_t* m_vb = nullptr;
+    struct vec3* m_points = nullptr;  /* Owned by m_vb */
+    struct vec2* m_uvs = nullptr;     /* Owned by m_vb */
+    uint32_t m_capacity = 0;
+    uint32_t m_count = 0;
+};
@@ -0,0 +1,109 @@
+/**
+ * This file is part of input-overlay
+ * which is licensed under the MPL 2.0 license
+ * See LICENSE or mozilla.org/en-US/MPL/2.0/
+ * github.com/univrsal/input-overlay
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Bounded, lock-free single producer/single consumer ring buffer.
+ * Only one thread may push and only one (other) thread may pop.
+ * The producer and consumer indices live on separate cache lines,
+ * each side additionally caches the index of the other side, so
+ * the shared lines are only touched when the ring looks full/empty.
+ * N has to be a power of two.
+ */
+template <class T, size_t N>
+class spsc_queue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "spsc_queue size must be a power of two");
+public:
+    spsc_queue() = default;
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    /* Producer side. Returns false and counts the item as dropped if the ring is full */
+    bool push(const T& item)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+
+        if (head - m_tail_cache == N)
+        {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tail_cache == N)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        m_items[head & (N - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer side. Returns false if the ring is empty */
+    bool pop(T& item)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail == m_head_cache)
+        {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail == m_head_cache)
+                return false;
+        }
+
+        item = m_items[tail & (N - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer side. Hands every item that was queued at the time of
+     * the call to f and releases them all at once. Items pushed while
+     * draining are left for the next call, so this always terminates.
+     */
+    template <class F>
+    size_t drain(F&& f)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        m_head_cache = m_head.load(std::memory_order_acquire);
+
+        for (auto i = tail; i != m_head_cache; i++)
+            f(m_items[i & (N - 1)]);
+
+        m_tail.store(m_head_cache, std::memory_order_release);
+        return m_head_cache - tail;
+    }
+
+    /* Number of items rejected because the ring was full */
+    size_t dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+private:
+    /* Written by producer */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+    size_t m_tail_cache = 0;
+    std::atomic<size_t> m_dropped{0};
+
+    /* Written by consumer */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+    size_t m_head_cache = 0;
+
+    alignas(CACHE_LINE_SIZE) T m_items[N];
+};
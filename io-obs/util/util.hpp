@@ -177,6 +177,11 @@
 #define T_OVERLAY_COMMAND_MODE          T_("Overlay.Commandmode")
 
 #define T_MENU_OPEN_SETTINGS		T_("Menu.InputOverlay.OpenSettings")
+#define T_MENU_LATENCY_STATS		T_("Menu.InputOverlay.LatencyStats")
+#define T_MENU_RECORD_INPUT		T_("Menu.InputOverlay.RecordInput")
+#define T_MENU_REPLAY_INPUT		T_("Menu.InputOverlay.ReplayInput")
+#define T_RECORDING_FILES		T_("Dialog.InputOverlay.Recording.Files")
+#define T_RECORDING_SPEED		T_("Dialog.InputOverlay.Recording.Speed")
 
 #define WHEEL_UP        -1
 #define WHEEL_DOWN      1
@@ -206,7 +211,9 @@
 #define VC_DPAD_DATA        0xEC32
 
 #define PAD_TO_VC(a)        (a | VC_PAD_MASK)
-#define PAD_COUNT 4
+/* Pads a source can show. Their state is 16 bytes each, so this
+ * leaves room for couch setups at little cost */
+#define PAD_COUNT           16
 
 #define PAD_ICON_COUNT      22
 #define PAD_BUTTON_COUNT    17
@@ -235,6 +242,23 @@
 #define PAD_LT              15
 #define PAD_RT              16
 
+/* Bits of xinput's wButtons, remote and evdev pads are described with these */
+#define PAD_BIT_DPAD_UP     0x0001
+#define PAD_BIT_DPAD_DOWN   0x0002
+#define PAD_BIT_DPAD_LEFT   0x0004
+#define PAD_BIT_DPAD_RIGHT  0x0008
+#define PAD_BIT_START       0x0010
+#define PAD_BIT_BACK        0x0020
+#define PAD_BIT_L_ANALOG    0x0040
+#define PAD_BIT_R_ANALOG    0x0080
+#define PAD_BIT_LB          0x0100
+#define PAD_BIT_RB          0x0200
+#define PAD_BIT_GUIDE       0x0400
+#define PAD_BIT_A           0x1000
+#define PAD_BIT_B           0x2000
+#define PAD_BIT_X           0x4000
+#define PAD_BIT_Y           0x8000
+
 /* Get default key names from a libuiohook keycode */
 const char* key_to_text(int key_code);
 